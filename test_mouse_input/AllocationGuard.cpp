@@ -0,0 +1,84 @@
+#include "AllocationGuard.h"
+#include <cstdlib>
+#include <new>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#include <malloc.h>
+#include <windows.h>
+#endif
+
+thread_local int AllocationGuard::depth = 0;
+std::atomic<uint64_t> AllocationGuard::violations{0};
+std::atomic<size_t> AllocationGuard::lastSize{0};
+
+void AllocationGuard::onViolation()
+{
+#if defined(_MSC_VER) && defined(_DEBUG)
+    // Break here and look at the call stack to see who allocated on the hot path. Without
+    // a debugger attached the break would kill the process, so then it is only counted.
+    if (IsDebuggerPresent())
+    {
+        __debugbreak();
+    }
+#endif
+}
+
+#if NK_ALLOCATION_GUARD
+
+namespace
+{
+    void *allocate(size_t size)
+    {
+        AllocationGuard::onAllocation(size);
+        void *memory = std::malloc(size != 0 ? size : 1);
+        if (memory == nullptr)
+        {
+            throw std::bad_alloc();
+        }
+        return memory;
+    }
+
+    void *allocateAligned(size_t size, std::align_val_t alignment)
+    {
+        AllocationGuard::onAllocation(size);
+        const size_t align = static_cast<size_t>(alignment);
+#if defined(_MSC_VER)
+        void *memory = _aligned_malloc(size != 0 ? size : 1, align);
+#else
+        void *memory = nullptr;
+        if (posix_memalign(&memory, align < sizeof(void *) ? sizeof(void *) : align, size != 0 ? size : 1) != 0)
+        {
+            memory = nullptr;
+        }
+#endif
+        if (memory == nullptr)
+        {
+            throw std::bad_alloc();
+        }
+        return memory;
+    }
+
+    void releaseAligned(void *memory)
+    {
+#if defined(_MSC_VER)
+        _aligned_free(memory);
+#else
+        std::free(memory);
+#endif
+    }
+}
+
+void *operator new(size_t size) { return allocate(size); }
+void *operator new[](size_t size) { return allocate(size); }
+void *operator new(size_t size, std::align_val_t alignment) { return allocateAligned(size, alignment); }
+void *operator new[](size_t size, std::align_val_t alignment) { return allocateAligned(size, alignment); }
+void operator delete(void *memory) noexcept { std::free(memory); }
+void operator delete[](void *memory) noexcept { std::free(memory); }
+void operator delete(void *memory, size_t) noexcept { std::free(memory); }
+void operator delete[](void *memory, size_t) noexcept { std::free(memory); }
+void operator delete(void *memory, std::align_val_t) noexcept { releaseAligned(memory); }
+void operator delete[](void *memory, std::align_val_t) noexcept { releaseAligned(memory); }
+void operator delete(void *memory, size_t, std::align_val_t) noexcept { releaseAligned(memory); }
+void operator delete[](void *memory, size_t, std::align_val_t) noexcept { releaseAligned(memory); }
+
+#endif
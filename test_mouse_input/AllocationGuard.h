@@ -0,0 +1,63 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Catches heap allocations on the key-event path.
+//
+// Nothing between hook entry and injection may allocate after startup: allocator locks
+// are the main source of hook latency spikes under memory pressure. When the guard is
+// compiled in, AllocationGuard.cpp replaces the global operator new/delete, and any
+// allocation made while a Scope is open on the calling thread is counted (and breaks
+// into the debugger in debug builds). It is on by default in debug builds only, and
+// Scope costs nothing when it is off.
+
+#ifndef NK_ALLOCATION_GUARD
+#ifdef _DEBUG
+#define NK_ALLOCATION_GUARD 1
+#else
+#define NK_ALLOCATION_GUARD 0
+#endif
+#endif
+
+class AllocationGuard
+{
+public:
+    // Marks the current thread as being on the hot path until it goes out of scope.
+    class Scope
+    {
+    public:
+#if NK_ALLOCATION_GUARD
+        Scope() { depth++; }
+        ~Scope() { depth--; }
+#else
+        Scope() {}
+#endif
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+    };
+
+    static bool enabled() { return NK_ALLOCATION_GUARD != 0; }
+    // Allocations made inside a Scope since startup.
+    static uint64_t hotPathAllocations() { return violations.load(std::memory_order_relaxed); }
+    // Size of the most recent such allocation, to help find it.
+    static size_t lastViolationSize() { return lastSize.load(std::memory_order_relaxed); }
+
+    // Called by the replaced operator new.
+    static void onAllocation(size_t size)
+    {
+        if (depth > 0)
+        {
+            violations.fetch_add(1, std::memory_order_relaxed);
+            lastSize.store(size, std::memory_order_relaxed);
+            onViolation();
+        }
+    }
+
+private:
+    static void onViolation();
+
+    static thread_local int depth;
+    static std::atomic<uint64_t> violations;
+    static std::atomic<size_t> lastSize;
+};
@@ -1,5 +1,5 @@
 #pragma once
-#include <windows.h>
+#include "Win32Compat.h"
 #include <cctype>
 
 inline int CharToVK(char key)
@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+#include "OutputEvent.h" // MouseButton
+
+// What a mode does with a key while it is active.
+enum class KeyActionKind : uint8_t
+{
+    Passthrough = 0, // not ours, let the system have it
+    Remap,           // target is the VK code to send instead
+    MouseButton,     // target is a MouseButton
+    MotionAxis,      // target is a MotionAxis
+    ScrollAxis,      // target is a ScrollAxis
+    Macro,           // the mode's MacroTable holds the events for this key
+    Swallow,         // consumed, but nothing to do (e.g. the mode's own activation key)
+};
+
+enum MotionAxis : uint8_t
+{
+    MOTION_LEFT = 0,
+    MOTION_RIGHT,
+    MOTION_UP,
+    MOTION_DOWN,
+};
+
+enum ScrollAxis : uint8_t
+{
+    SCROLL_UP = 0,
+    SCROLL_DOWN,
+    SCROLL_LEFT,
+    SCROLL_RIGHT,
+};
+
+struct KeyAction
+{
+    KeyActionKind kind = KeyActionKind::Passthrough;
+    uint8_t target = 0;
+
+    bool consumes() const { return kind != KeyActionKind::Passthrough; }
+    // Held, the key drives continuous motion that the mode's Update() has to integrate.
+    bool needsTicks() const { return kind == KeyActionKind::MotionAxis || kind == KeyActionKind::ScrollAxis; }
+};
+
+// A flat, cache-line aligned array of actions indexed by virtual-key code.
+// Built once per mode in Mode::compileDispatch(), read-only afterwards, so the hook,
+// the engine and the physics thread can all index it without synchronisation.
+struct alignas(64) KeyDispatchTable
+{
+    KeyAction actions[256];
+
+    const KeyAction &operator[](int vkCode) const { return actions[vkCode & 0xFF]; }
+    KeyAction &operator[](int vkCode) { return actions[vkCode & 0xFF]; }
+};
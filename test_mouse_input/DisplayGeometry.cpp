@@ -0,0 +1,226 @@
+#include "DisplayGeometry.h"
+#include <algorithm>
+#include "Log.h"
+#ifdef _WIN32
+#include <windows.h>
+#include <shellscalingapi.h>
+#ifdef _MSC_VER
+#pragma comment(lib, "Shcore.lib")
+#endif
+#endif
+
+SeqLocked<DisplayLayout> DisplayGeometry::current;
+std::atomic<uint64_t> DisplayGeometry::refreshes{0};
+
+namespace
+{
+    // Sort and de-duplicate edges[0..count); returns the new count.
+    int uniqueEdges(int32_t *edges, int count)
+    {
+        std::sort(edges, edges + count);
+        return static_cast<int>(std::unique(edges, edges + count) - edges);
+    }
+
+    // Distance along one axis from value to [low, high).
+    int64_t axisDistance(int value, int low, int high)
+    {
+        if (value < low)
+            return static_cast<int64_t>(low) - value;
+        if (value >= high)
+            return static_cast<int64_t>(value) - (high - 1);
+        return 0;
+    }
+}
+
+bool DisplayLayout::build(const MonitorInfo *list, int count)
+{
+    monitorCount = 0;
+    for (int i = 0; i < count && monitorCount < MAX_MONITORS; i++)
+    {
+        if (list[i].width() > 0 && list[i].height() > 0)
+        {
+            monitors[monitorCount++] = list[i];
+        }
+    }
+    xEdgeCount = 0;
+    yEdgeCount = 0;
+    bounds = MonitorInfo();
+    if (monitorCount == 0)
+    {
+        return false;
+    }
+
+    bounds = monitors[0];
+    bounds.primary = 0;
+    for (int i = 0; i < monitorCount; i++)
+    {
+        const MonitorInfo &m = monitors[i];
+        bounds.left = std::min(bounds.left, m.left);
+        bounds.top = std::min(bounds.top, m.top);
+        bounds.right = std::max(bounds.right, m.right);
+        bounds.bottom = std::max(bounds.bottom, m.bottom);
+        xEdges[2 * i] = m.left;
+        xEdges[2 * i + 1] = m.right;
+        yEdges[2 * i] = m.top;
+        yEdges[2 * i + 1] = m.bottom;
+    }
+    xEdgeCount = static_cast<uint8_t>(uniqueEdges(xEdges, 2 * monitorCount));
+    yEdgeCount = static_cast<uint8_t>(uniqueEdges(yEdges, 2 * monitorCount));
+
+    // Every cell lies entirely inside or outside each monitor, so its top-left corner decides.
+    for (int column = 0; column + 1 < xEdgeCount; column++)
+    {
+        for (int row = 0; row + 1 < yEdgeCount; row++)
+        {
+            int8_t owner = NO_MONITOR;
+            for (int i = 0; i < monitorCount; i++)
+            {
+                if (monitors[i].contains(xEdges[column], yEdges[row]))
+                {
+                    owner = static_cast<int8_t>(i);
+                    break;
+                }
+            }
+            cells[column * (MAX_EDGES - 1) + row] = owner;
+        }
+    }
+    return true;
+}
+
+int DisplayLayout::findCell(const int32_t *edges, int count, int value)
+{
+    if (count < 2 || value < edges[0] || value >= edges[count - 1])
+    {
+        return -1;
+    }
+    return static_cast<int>(std::upper_bound(edges, edges + count, value) - edges) - 1;
+}
+
+int DisplayLayout::monitorAt(int x, int y) const
+{
+    const int column = findCell(xEdges, xEdgeCount, x);
+    const int row = findCell(yEdges, yEdgeCount, y);
+    if (column < 0 || row < 0)
+    {
+        return NO_MONITOR;
+    }
+    return cells[column * (MAX_EDGES - 1) + row];
+}
+
+int DisplayLayout::nearestMonitor(int x, int y) const
+{
+    const int hit = monitorAt(x, y);
+    if (hit != NO_MONITOR || monitorCount == 0)
+    {
+        return hit;
+    }
+    int best = 0;
+    int64_t bestDistance = INT64_MAX;
+    for (int i = 0; i < monitorCount; i++)
+    {
+        const MonitorInfo &m = monitors[i];
+        const int64_t dx = axisDistance(x, m.left, m.right);
+        const int64_t dy = axisDistance(y, m.top, m.bottom);
+        const int64_t distance = dx * dx + dy * dy;
+        if (distance < bestDistance)
+        {
+            bestDistance = distance;
+            best = i;
+        }
+    }
+    return best;
+}
+
+bool DisplayLayout::clamp(int &x, int &y) const
+{
+    const int index = nearestMonitor(x, y);
+    if (index == NO_MONITOR)
+    {
+        return false;
+    }
+    const MonitorInfo &m = monitors[index];
+    const int clampedX = std::min(std::max(x, m.left), m.right - 1);
+    const int clampedY = std::min(std::max(y, m.top), m.bottom - 1);
+    const bool moved = clampedX != x || clampedY != y;
+    x = clampedX;
+    y = clampedY;
+    return moved;
+}
+
+void DisplayGeometry::publish(const DisplayLayout &layout)
+{
+    current.store(layout);
+    refreshes.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool DisplayGeometry::update(DisplayLayout &layout, uint64_t &seenVersion)
+{
+    const uint64_t version = current.version();
+    if (version == seenVersion)
+    {
+        return false;
+    }
+    layout = current.load();
+    seenVersion = version;
+    return true;
+}
+
+#ifdef _WIN32
+namespace
+{
+    struct MonitorList
+    {
+        MonitorInfo monitors[DisplayLayout::MAX_MONITORS];
+        int count = 0;
+    };
+
+    BOOL CALLBACK collectMonitor(HMONITOR monitor, HDC, LPRECT, LPARAM param)
+    {
+        MonitorList &list = *reinterpret_cast<MonitorList *>(param);
+        if (list.count >= DisplayLayout::MAX_MONITORS)
+        {
+            return FALSE;
+        }
+        MONITORINFO info = {};
+        info.cbSize = sizeof(info);
+        if (!GetMonitorInfoW(monitor, &info))
+        {
+            return TRUE;
+        }
+        UINT dpiX = 96, dpiY = 96;
+        if (FAILED(GetDpiForMonitor(monitor, MDT_EFFECTIVE_DPI, &dpiX, &dpiY)))
+        {
+            dpiX = 96;
+        }
+        MonitorInfo &entry = list.monitors[list.count++];
+        entry.left = info.rcMonitor.left;
+        entry.top = info.rcMonitor.top;
+        entry.right = info.rcMonitor.right;
+        entry.bottom = info.rcMonitor.bottom;
+        entry.dpi = static_cast<uint16_t>(dpiX);
+        entry.primary = (info.dwFlags & MONITORINFOF_PRIMARY) != 0 ? 1 : 0;
+        return TRUE;
+    }
+}
+
+bool DisplayGeometry::refreshFromSystem()
+{
+    MonitorList list;
+    EnumDisplayMonitors(NULL, NULL, collectMonitor, reinterpret_cast<LPARAM>(&list));
+    DisplayLayout layout;
+    if (!layout.build(list.monitors, list.count))
+    {
+        LOG_WARN("Display geometry: no monitors found");
+        return false;
+    }
+    publish(layout);
+    const MonitorInfo &desktop = layout.desktop();
+    LOG_INFO("Display geometry: {} monitors, desktop {}x{}", layout.count(), desktop.width(), desktop.height());
+    return true;
+}
+#else
+bool DisplayGeometry::refreshFromSystem()
+{
+    return false;
+}
+#endif
@@ -0,0 +1,86 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include "SeqLock.h"
+
+// One monitor of the virtual desktop, in physical pixels. right/bottom are exclusive.
+struct MonitorInfo
+{
+    int32_t left = 0;
+    int32_t top = 0;
+    int32_t right = 0;
+    int32_t bottom = 0;
+    uint16_t dpi = 96;
+    uint8_t primary = 0;
+
+    bool contains(int x, int y) const { return x >= left && x < right && y >= top && y < bottom; }
+    int width() const { return right - left; }
+    int height() const { return bottom - top; }
+};
+
+// The monitor layout of the virtual desktop, as a flat, trivially copyable value.
+//
+// build() sorts the distinct left/right and top/bottom edges of all monitors and fills a
+// small grid with one cell per pair of neighbouring edges, each holding the monitor that
+// covers it. monitorAt() is then two binary searches over at most MAX_EDGES edges and one
+// table read, whatever the shape of the layout. Nothing here touches the OS, so layouts can
+// be built from synthetic monitor lists.
+class DisplayLayout
+{
+public:
+    static constexpr int MAX_MONITORS = 16;
+    static constexpr int MAX_EDGES = 2 * MAX_MONITORS;
+    static constexpr int NO_MONITOR = -1;
+
+    // Monitors past MAX_MONITORS, and empty ones, are ignored. Returns false if none are left.
+    bool build(const MonitorInfo *monitors, int count);
+
+    int count() const { return monitorCount; }
+    const MonitorInfo &monitor(int index) const { return monitors[index]; }
+    // Bounding box of every monitor.
+    const MonitorInfo &desktop() const { return bounds; }
+
+    // Index of the monitor containing (x, y), or NO_MONITOR if the point is off every monitor.
+    int monitorAt(int x, int y) const;
+    // The monitor containing (x, y), or else the one closest to it; NO_MONITOR if the layout is empty.
+    int nearestMonitor(int x, int y) const;
+    // Move (x, y) onto the nearest monitor. Returns true if it had to move.
+    bool clamp(int &x, int &y) const;
+
+private:
+    // Largest i with edges[i] <= value, or -1 if value is outside [edges[0], edges[count - 1]).
+    static int findCell(const int32_t *edges, int count, int value);
+
+    MonitorInfo monitors[MAX_MONITORS];
+    MonitorInfo bounds;
+    int32_t xEdges[MAX_EDGES] = {};
+    int32_t yEdges[MAX_EDGES] = {};
+    int8_t cells[(MAX_EDGES - 1) * (MAX_EDGES - 1)] = {};
+    uint8_t monitorCount = 0;
+    uint8_t xEdgeCount = 0;
+    uint8_t yEdgeCount = 0;
+};
+
+// The process-wide display geometry. A refresh (at startup, and from the display window on
+// WM_DISPLAYCHANGE and friends) publishes a new DisplayLayout through a seqlock; readers
+// keep their own copy and only copy again when the version has moved, so a tick costs one
+// atomic load instead of GetSystemMetrics calls.
+class DisplayGeometry
+{
+public:
+    static void publish(const DisplayLayout &layout);
+
+    // Copy the current layout into 'layout' if it changed since 'seenVersion'.
+    // Returns true if it copied.
+    static bool update(DisplayLayout &layout, uint64_t &seenVersion);
+
+    // Query the monitors from the OS and publish them. Returns false if that is not
+    // possible (always, off Windows, where replay publishes a synthetic layout instead).
+    static bool refreshFromSystem();
+
+    static uint64_t refreshCount() { return refreshes.load(std::memory_order_relaxed); }
+
+private:
+    static SeqLocked<DisplayLayout> current;
+    static std::atomic<uint64_t> refreshes;
+};
@@ -0,0 +1,40 @@
+#include "EventClock.h"
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+EventClock::Source EventClock::source = EventClock::systemNow;
+std::atomic<uint64_t> VirtualClock::value{0};
+
+uint64_t EventClock::systemNow()
+{
+#ifdef _WIN32
+    static const uint64_t frequency = []
+    {
+        LARGE_INTEGER f;
+        QueryPerformanceFrequency(&f);
+        return static_cast<uint64_t>(f.QuadPart);
+    }();
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    const uint64_t ticks = static_cast<uint64_t>(counter.QuadPart);
+    // Split the conversion so ticks * SECOND can't overflow.
+    return (ticks / frequency) * SECOND + (ticks % frequency) * SECOND / frequency;
+#else
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * SECOND + static_cast<uint64_t>(ts.tv_nsec);
+#endif
+}
+
+void EventClock::setSource(Source newSource)
+{
+    source = newSource != nullptr ? newSource : systemNow;
+}
+
+void VirtualClock::install()
+{
+    EventClock::setSource(VirtualClock::now);
+}
@@ -0,0 +1,102 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+// The one clock every timestamp in the app comes from: monotonic, 64-bit, nanoseconds.
+// Backed by QueryPerformanceCounter on Windows and CLOCK_MONOTONIC elsewhere.
+// The source can be swapped for VirtualClock so timing logic runs deterministically.
+class EventClock
+{
+public:
+    typedef uint64_t (*Source)();
+
+    static constexpr uint64_t MICROSECOND = 1000ull;
+    static constexpr uint64_t MILLISECOND = 1000000ull;
+    static constexpr uint64_t SECOND = 1000000000ull;
+
+    static uint64_t now() { return source(); }
+
+    // The real monotonic clock, regardless of the installed source.
+    static uint64_t systemNow();
+
+    // Install a different source; nullptr restores systemNow.
+    static void setSource(Source newSource);
+
+private:
+    static Source source;
+};
+
+// A manually driven clock for deterministic runs. install() makes EventClock::now() return it.
+class VirtualClock
+{
+public:
+    static void install();
+    static uint64_t now() { return value.load(std::memory_order_acquire); }
+    static void set(uint64_t nanos) { value.store(nanos, std::memory_order_release); }
+    static void advance(uint64_t nanos) { value.fetch_add(nanos, std::memory_order_acq_rel); }
+
+private:
+    static std::atomic<uint64_t> value;
+};
+
+// Turns the 32-bit millisecond KBDLLHOOKSTRUCT::time of an event into an EventClock time.
+//
+// The event time says when the system generated the event but wraps every 49.7 days and
+// only advances with the ~15.6 ms system tick; the hook's own EventClock reading is
+// precise but includes however long the event queued before reaching us. The reconciler
+// unwraps the event time to 64 bits, tracks the offset between the two clocks (the
+// smallest offset seen is the one with the least queueing), and uses the hook's reading
+// unless the event time shows it arrived more than a tick late.
+class EventTimeReconciler
+{
+public:
+    // Longest a timely event can appear to be delayed because of the coarse event clock.
+    static constexpr uint64_t TICK_SLACK = 16 * EventClock::MILLISECOND;
+    // How long an offset estimate is trusted before it is re-based, to follow clock drift.
+    static constexpr uint64_t OFFSET_WINDOW = 10 * EventClock::SECOND;
+
+    uint64_t reconcile(uint32_t eventMs, uint64_t now)
+    {
+        if (!initialised)
+        {
+            extendedMs = eventMs;
+            initialised = true;
+        }
+        else
+        {
+            // Signed difference so a slightly out-of-order stamp doesn't look like a wrap.
+            extendedMs += static_cast<int32_t>(eventMs - lastMs);
+        }
+        lastMs = eventMs;
+
+        const int64_t candidate = static_cast<int64_t>(now) - static_cast<int64_t>(extendedMs * EventClock::MILLISECOND);
+        if (!haveOffset || candidate < offset || now - offsetSetAt > OFFSET_WINDOW)
+        {
+            offset = candidate;
+            offsetSetAt = now;
+            haveOffset = true;
+        }
+
+        uint64_t stamp = static_cast<uint64_t>(static_cast<int64_t>(extendedMs * EventClock::MILLISECOND) + offset) + TICK_SLACK;
+        if (stamp > now)
+        {
+            stamp = now;
+        }
+        // Never hand out a stamp earlier than the previous one.
+        if (stamp < lastStamp)
+        {
+            stamp = lastStamp;
+        }
+        lastStamp = stamp;
+        return stamp;
+    }
+
+private:
+    bool initialised = false;
+    bool haveOffset = false;
+    uint32_t lastMs = 0;
+    uint64_t extendedMs = 0;
+    int64_t offset = 0;
+    uint64_t offsetSetAt = 0;
+    uint64_t lastStamp = 0;
+};
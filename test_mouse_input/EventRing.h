@@ -0,0 +1,73 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// A bounded, wait-free single-producer/single-consumer ring.
+// The keyboard hook is the only producer and the engine thread the only consumer,
+// so push() and pop() never block and never allocate: each is a couple of loads,
+// one copy and one release store. When the ring is full push() drops the record
+// and bumps overflowCount() instead of waiting for the consumer.
+template <typename T, size_t Capacity>
+class EventRing
+{
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "EventRing capacity must be a power of two");
+
+public:
+    // Producer side. Returns false (and counts an overflow) if the ring is full.
+    bool push(const T &item)
+    {
+        const uint64_t head = head_.load(std::memory_order_relaxed);
+        const uint64_t tail = tail_.load(std::memory_order_acquire);
+        const uint64_t used = head - tail;
+        if (used >= Capacity)
+        {
+            overflowCount_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        slots_[head & (Capacity - 1)] = item;
+        head_.store(head + 1, std::memory_order_release);
+        // Only the producer writes the high-water mark, so a plain load/store pair is enough.
+        if (used + 1 > highWaterMark_.load(std::memory_order_relaxed))
+        {
+            highWaterMark_.store(used + 1, std::memory_order_relaxed);
+        }
+        return true;
+    }
+
+    // Consumer side. Returns false if the ring is empty.
+    bool pop(T &item)
+    {
+        const uint64_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail == head_.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        item = slots_[tail & (Capacity - 1)];
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Approximate number of queued records; exact only when called from one of the two ends.
+    size_t size() const
+    {
+        return static_cast<size_t>(head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire));
+    }
+
+    static constexpr size_t capacity() { return Capacity; }
+
+    // Largest fill level the producer has ever observed.
+    uint64_t highWaterMark() const { return highWaterMark_.load(std::memory_order_relaxed); }
+
+    // Records the producer had to drop because the consumer fell behind.
+    uint64_t overflowCount() const { return overflowCount_.load(std::memory_order_relaxed); }
+
+private:
+    // Producer and consumer indices live on separate cache lines so the two threads
+    // don't bounce a shared line on every event.
+    alignas(64) std::atomic<uint64_t> head_{0};
+    std::atomic<uint64_t> highWaterMark_{0};
+    std::atomic<uint64_t> overflowCount_{0};
+    alignas(64) std::atomic<uint64_t> tail_{0};
+    alignas(64) T slots_[Capacity];
+};
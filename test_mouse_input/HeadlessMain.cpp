@@ -0,0 +1,10 @@
+// Entry point for non-Windows builds, which have no keyboard hook: the mode engine only
+// runs headless, replaying scripts (see Replay.h), optionally into uinput with --uinput.
+#ifndef _WIN32
+#include "Replay.h"
+
+int main(int argc, char *argv[])
+{
+    return Replay::runFromArguments(argc, argv);
+}
+#endif
@@ -0,0 +1,87 @@
+#include "HookCapture.h"
+#include "ModeManager.h"
+
+EventRing<KeyEvent, HookCapture::RING_CAPACITY> HookCapture::ring;
+std::atomic<uint64_t> HookCapture::selfInjectedCount{0};
+EventTimeReconciler HookCapture::eventTime;
+Mode *HookCapture::activeMode = nullptr;
+int HookCapture::activatedBy = 0;
+std::atomic<uint64_t> HookCapture::repeatCount{0};
+uint64_t HookCapture::heldKeys[4] = {};
+uint8_t HookCapture::verdicts[256] = {};
+
+bool HookCapture::isSelfInjected(const KBDLLHOOKSTRUCT &keyboard)
+{
+    if ((keyboard.flags & LLKHF_INJECTED) == 0 || keyboard.dwExtraInfo != injectionSignature())
+    {
+        return false;
+    }
+    // Only the hook thread writes this, so a load/store pair avoids a locked add.
+    selfInjectedCount.store(selfInjectedCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    return true;
+}
+
+bool HookCapture::capture(const KBDLLHOOKSTRUCT &keyboard, bool isDown)
+{
+    const int vkCode = static_cast<int>(keyboard.vkCode & 0xFF);
+    bool consume = false;
+    bool bypass = false;
+    if (activeMode == nullptr)
+    {
+        Mode *activating = isDown ? Mode::activationTable[vkCode] : nullptr;
+        if (activating != nullptr && activating->degraded)
+        {
+            bypass = true;
+        }
+        else if (activating != nullptr)
+        {
+            activeMode = activating;
+            activatedBy = vkCode;
+            consume = true;
+        }
+    }
+    else if (activeMode->degraded)
+    {
+        activeMode = nullptr;
+        bypass = true;
+    }
+    else if (vkCode == activatedBy)
+    {
+        // Repeats of the activation key are swallowed; its release ends the mode.
+        if (!isDown)
+        {
+            activeMode = nullptr;
+        }
+        consume = true;
+    }
+    else
+    {
+        consume = activeMode->actionFor(vkCode).consumes();
+    }
+
+    KeyEvent event;
+    event.vkCode = static_cast<uint16_t>(vkCode);
+    event.scanCode = static_cast<uint16_t>(keyboard.scanCode);
+    event.flags = static_cast<uint8_t>(keyboard.flags);
+    event.capture = (consume ? KeyEvent::CONSUMED : 0) | (bypass ? KeyEvent::BYPASS : 0);
+    event.timestamp = eventTime.reconcile(keyboard.time, EventClock::now());
+    ring.push(event);
+    if (isDown)
+    {
+        heldKeys[vkCode >> 6] |= 1ull << (vkCode & 63);
+        verdicts[vkCode] = consume ? 1 : 0;
+    }
+    else
+    {
+        heldKeys[vkCode >> 6] &= ~(1ull << (vkCode & 63));
+    }
+    return consume;
+}
+
+void HookCapture::degradeActiveMode()
+{
+    if (activeMode != nullptr)
+    {
+        activeMode->degraded = true;
+    }
+}
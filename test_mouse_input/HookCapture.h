@@ -0,0 +1,92 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include "Win32Compat.h"
+#include "EventRing.h"
+#include "EventClock.h"
+
+class Mode;
+
+// Compact record of one keyboard event, as pushed by the hook and drained by the engine thread.
+struct KeyEvent
+{
+    // Bits of 'capture'.
+    static constexpr uint8_t CONSUMED = 0x01; // the hook swallowed the event
+    static constexpr uint8_t BYPASS = 0x02;   // a degraded mode was skipped; the engine must not run mode logic
+
+    uint16_t vkCode = 0;
+    uint16_t scanCode = 0;
+    uint8_t flags = 0;      // KBDLLHOOKSTRUCT::flags (LLKHF_UP marks a release)
+    uint8_t capture = 0;    // what the hook decided
+    uint64_t timestamp = 0; // when the event happened, EventClock ns (see EventTimeReconciler)
+
+    bool isDown() const { return (flags & LLKHF_UP) == 0; }
+    bool isBypass() const { return (capture & BYPASS) != 0; }
+};
+
+// The capture stage of the keyboard hook.
+// LowLevelKeyboardProc must return quickly or Windows drops keys (and eventually the hook),
+// so all it does is decide consume-or-pass from the tables built by Mode::compileDispatchTables()
+// and hand the event to the engine thread through a lock-free ring. The real mode logic
+// (activation, remapping, key state, SendInput) runs on the engine thread.
+//
+// The capture side keeps its own copy of "which mode is active". It follows exactly the
+// same rules as Mode::checkIfActivatesMode / Mode::checkActiveModeEnded, so it stays in
+// step with Mode::currentMode without ever having to wait for the engine. The one place
+// they would diverge is a degraded mode: the capture side drops it and marks the event
+// BYPASS, and the engine drops its current mode when it sees that mark.
+class HookCapture
+{
+public:
+    static const size_t RING_CAPACITY = 1024;
+
+    // Called from the hook for every HC_ACTION event. Returns true if the event should be consumed.
+    static bool capture(const KBDLLHOOKSTRUCT &keyboard, bool isDown);
+
+    // The first thing the hook asks: is this an OS autorepeat of a key we already saw go
+    // down? If so it is not captured at all; 'consume' gets the verdict the original press
+    // got, so a repeat is swallowed or passed exactly like its press. One bit test against
+    // the hook's own held-key bitmap.
+    static bool filterRepeat(const KBDLLHOOKSTRUCT &keyboard, bool isDown, bool &consume)
+    {
+        const int vkCode = static_cast<int>(keyboard.vkCode & 0xFF);
+        if (!isDown || (heldKeys[vkCode >> 6] & (1ull << (vkCode & 63))) == 0)
+        {
+            return false;
+        }
+        consume = verdicts[vkCode] != 0;
+        repeatCount.store(repeatCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // True for events we injected ourselves (LLKHF_INJECTED plus our dwExtraInfo signature).
+    // The hook passes these straight on without touching mode state or the ring.
+    static bool isSelfInjected(const KBDLLHOOKSTRUCT &keyboard);
+
+    // Every event we inject carries this in dwExtraInfo (see SendInputBackend), so the hook
+    // can recognise its own output. Mixing in the process id keeps two running instances
+    // from swallowing each other's output.
+    static ULONG_PTR injectionSignature()
+    {
+        static const ULONG_PTR signature = static_cast<ULONG_PTR>(0x4E4B0000u) ^ static_cast<ULONG_PTR>(GetCurrentProcessId());
+        return signature;
+    }
+
+    // Mark whichever mode is active as degraded (see Mode::degraded). Hook thread only.
+    static void degradeActiveMode();
+
+    static EventRing<KeyEvent, RING_CAPACITY> ring;
+    // Number of our own injected events the hook has seen and passed through.
+    static std::atomic<uint64_t> selfInjectedCount;
+    // Number of OS autorepeats dropped by filterRepeat.
+    static std::atomic<uint64_t> repeatCount;
+
+private:
+    static EventTimeReconciler eventTime;
+    static Mode *activeMode;
+    static int activatedBy;
+    // Keys the hook has seen go down and not yet up, and what it decided for each press.
+    // Hook thread only.
+    static uint64_t heldKeys[4];
+    static uint8_t verdicts[256];
+};
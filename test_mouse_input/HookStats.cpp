@@ -0,0 +1,45 @@
+#include "HookStats.h"
+#include <iomanip>
+
+LatencyHistogram HookStats::stages[HookStats::STAGE_COUNT];
+
+const char *HookStats::stageName(Stage stage)
+{
+    switch (stage)
+    {
+    case HOOK_CALLBACK:
+        return "hook callback";
+    case MODE_ACTIVATION:
+        return "mode activation";
+    case MODE_HANDLING:
+        return "mode handling";
+    case KEY_STATE_UPDATE:
+        return "updateKeyState";
+    case SEND_INPUT:
+        return "SendInput";
+    case INJECTION_QUEUE:
+        return "injection queue";
+    case TICK_JITTER:
+        return "tick jitter";
+    default:
+        return "unknown";
+    }
+}
+
+void HookStats::report(std::ostream &out)
+{
+    // Durations are printed in microseconds.
+    out << "Stage latency (us)      count        p50        p99      p99.9        max" << std::endl;
+    out << std::fixed << std::setprecision(2);
+    for (int i = 0; i < STAGE_COUNT; i++)
+    {
+        const LatencyHistogram &histogram = stages[i];
+        out << std::left << std::setw(18) << stageName(static_cast<Stage>(i)) << std::right
+            << std::setw(11) << histogram.count()
+            << std::setw(11) << histogram.percentile(50.0) / 1000.0
+            << std::setw(11) << histogram.percentile(99.0) / 1000.0
+            << std::setw(11) << histogram.percentile(99.9) / 1000.0
+            << std::setw(11) << histogram.max() / 1000.0 << std::endl;
+    }
+    out << std::defaultfloat;
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <cstdint>
+#include <ostream>
+#include "LatencyHistogram.h"
+#include "EventClock.h"
+
+// Always-on latency instrumentation for the key-event pipeline.
+// Each stage has its own histogram; call sites take an EventClock timestamp with now() before and
+// after the stage and hand the difference to record(). Reports are printed at shutdown
+// and whenever the console receives Ctrl+Break.
+class HookStats
+{
+public:
+    enum Stage
+    {
+        HOOK_CALLBACK = 0, // the whole of LowLevelKeyboardProc
+        MODE_ACTIVATION,   // Mode::checkIfActivatesMode / Mode::checkActiveModeEnded
+        MODE_HANDLING,     // the active mode's handleKeyDownEvent / handleKeyUpEvent
+        KEY_STATE_UPDATE,  // updateKeyState
+        SEND_INPUT,        // each SendInput call made by SendInputBackend
+        INJECTION_QUEUE,   // a batch waiting in InjectionQueue for the injector thread
+        TICK_JITTER,       // how late TickScheduler woke the polling thread for a tick
+        STAGE_COUNT
+    };
+
+    // Monotonic timestamp in nanoseconds.
+    static uint64_t now() { return EventClock::now(); }
+
+    static void record(Stage stage, uint64_t start, uint64_t end)
+    {
+        stages[stage].record(end - start);
+    }
+
+    // Print count, p50/p99/p99.9/max for every stage.
+    static void report(std::ostream &out);
+
+    static const char *stageName(Stage stage);
+
+    static LatencyHistogram stages[STAGE_COUNT];
+};
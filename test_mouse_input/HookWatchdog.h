@@ -0,0 +1,106 @@
+#pragma once
+#include <cstdint>
+
+// Keeps an eye on the low-level keyboard hook.
+//
+// Windows gives a low-level hook LowLevelHooksTimeout to answer each event; past that it
+// passes the event on without us, and after repeated timeouts it silently removes the hook.
+// The watchdog does two things about that:
+//   - Budget: every callback reports how long the event took to answer. Once that gets
+//     within degradeFraction of the budget the caller switches the active mode to a pure
+//     passthrough verdict. When callbacks have stayed fast for recoverAfter, poll() says
+//     the modes can be restored.
+//   - Liveness: the hook records a heartbeat on every callback, and an independent source
+//     (raw input) reports every keyboard event the system saw. Input that arrives well
+//     after the last heartbeat means the hook is gone, and poll() asks for a re-install.
+//
+// All times are nanoseconds on whatever monotonic clock the caller uses, so the state
+// machine can be driven by a virtual clock. It is not thread-safe: in the app the hook,
+// the raw input handler and the poll timer all run on the main thread.
+class HookWatchdog
+{
+public:
+    struct Settings
+    {
+        uint64_t budget = 300000000ull;        // 300 ms
+        double degradeFraction = 0.5;          // degrade at half the budget
+        uint64_t recoverAfter = 5000000000ull; // 5 s without a slow callback
+        uint64_t heartbeatGap = 1000000000ull; // 1 s of input without a heartbeat
+    };
+
+    enum Action
+    {
+        NO_ACTION,
+        RESTORE_MODES,
+        REINSTALL_HOOK,
+    };
+
+    void configure(const Settings &newSettings) { settings = newSettings; }
+    const Settings &getSettings() const { return settings; }
+
+    // Hook side: 'elapsed' is how long the event had been waiting for an answer when the
+    // callback returned. Returns true if the caller should degrade the active mode.
+    bool onCallback(uint64_t now, uint64_t elapsed)
+    {
+        lastHeartbeat = now;
+        if (static_cast<double>(elapsed) < settings.degradeFraction * static_cast<double>(settings.budget))
+        {
+            return false;
+        }
+        lastSlowCallback = now;
+        if (!degraded)
+        {
+            degraded = true;
+            degradeCount++;
+        }
+        return true;
+    }
+
+    // The hook ran but skipped the budget check (e.g. for our own injected events).
+    void onHeartbeat(uint64_t now)
+    {
+        lastHeartbeat = now;
+    }
+
+    // A keyboard event the system delivered, seen without going through the hook.
+    void onObservedInput(uint64_t now)
+    {
+        lastObservedInput = now;
+    }
+
+    void onHookInstalled(uint64_t now)
+    {
+        lastHeartbeat = now;
+        lastObservedInput = now;
+    }
+
+    // Called periodically. At most one action is returned per call.
+    Action poll(uint64_t now)
+    {
+        if (lastObservedInput > lastHeartbeat + settings.heartbeatGap)
+        {
+            reinstallCount++;
+            onHookInstalled(now);
+            return REINSTALL_HOOK;
+        }
+        if (degraded && now - lastSlowCallback >= settings.recoverAfter)
+        {
+            degraded = false;
+            return RESTORE_MODES;
+        }
+        return NO_ACTION;
+    }
+
+    bool isDegraded() const { return degraded; }
+    uint64_t getDegradeCount() const { return degradeCount; }
+    uint64_t getReinstallCount() const { return reinstallCount; }
+
+private:
+    Settings settings;
+    bool degraded = false;
+    uint64_t lastHeartbeat = 0;
+    uint64_t lastObservedInput = 0;
+    uint64_t lastSlowCallback = 0;
+    uint64_t degradeCount = 0;
+    uint64_t reinstallCount = 0;
+};
@@ -0,0 +1,116 @@
+#include "InjectionBatcher.h"
+#include <cstring>
+#include "EventClock.h"
+
+std::atomic<OutputBackend *> InjectionBatcher::backend{nullptr};
+thread_local InjectionBatcher::Batch InjectionBatcher::pending;
+thread_local int InjectionBatcher::depth = 0;
+std::atomic<uint64_t> InjectionBatcher::submits{0};
+std::atomic<uint64_t> InjectionBatcher::events{0};
+std::atomic<uint64_t> InjectionBatcher::merged{0};
+std::atomic<uint64_t> InjectionBatcher::batchSizes[InjectionBatcher::MAX_BATCH + 1] = {};
+
+void InjectionBatcher::emit(const OutputEvent &event)
+{
+    if (depth == 0)
+    {
+        submit(&event, 1);
+        return;
+    }
+    Batch &batch = pending;
+    if ((event.kind == OutputKind::MouseMove || event.kind == OutputKind::Wheel) && batch.count > 0)
+    {
+        OutputEvent &last = batch.events[batch.count - 1];
+        if (last.kind == event.kind)
+        {
+            last.dx += event.dx;
+            last.dy += event.dy;
+            merged.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+    if (batch.count == MAX_BATCH)
+    {
+        flush();
+    }
+    batch.events[batch.count++] = event;
+}
+
+void InjectionBatcher::emitAll(const OutputEvent *sequence, size_t count)
+{
+    Batch &batch = pending;
+    if (depth == 0 || count > MAX_BATCH)
+    {
+        flush();
+        submit(sequence, count);
+        return;
+    }
+    if (batch.count + count > MAX_BATCH)
+    {
+        flush();
+    }
+    std::memcpy(batch.events + batch.count, sequence, count * sizeof(OutputEvent));
+    batch.count += count;
+}
+
+void InjectionBatcher::flush()
+{
+    Batch &batch = pending;
+    if (batch.count == 0)
+    {
+        return;
+    }
+    // Moves and scrolls that cancelled out are dropped rather than sent as zeros.
+    size_t count = 0;
+    for (size_t i = 0; i < batch.count; i++)
+    {
+        const OutputEvent &event = batch.events[i];
+        if ((event.kind == OutputKind::MouseMove || event.kind == OutputKind::Wheel) && event.dx == 0 && event.dy == 0)
+        {
+            continue;
+        }
+        batch.events[count++] = event;
+    }
+    batch.count = 0;
+    if (count > 0)
+    {
+        submit(batch.events, count);
+    }
+}
+
+void InjectionBatcher::submit(const OutputEvent *batch, size_t count)
+{
+    OutputBackend *output = getBackend();
+    if (output == nullptr)
+    {
+        return;
+    }
+    output->submit(batch, count);
+    submits.fetch_add(1, std::memory_order_relaxed);
+    events.fetch_add(count, std::memory_order_relaxed);
+    batchSizes[count < MAX_BATCH ? count : MAX_BATCH].fetch_add(1, std::memory_order_relaxed);
+}
+
+void InjectionBatcher::report(std::ostream &out, uint64_t elapsedNanos)
+{
+    const uint64_t calls = submitCount();
+    const double seconds = static_cast<double>(elapsedNanos) / EventClock::SECOND;
+    out << "Injection: " << eventCount() << " events in " << calls << " submits";
+    if (calls > 0)
+    {
+        out << " (" << static_cast<double>(eventCount()) / calls << " per submit)";
+    }
+    if (seconds > 0)
+    {
+        out << ", " << calls / seconds << " submits/s";
+    }
+    out << ", " << mergedCount() << " moves/scrolls merged" << std::endl;
+    for (size_t size = 1; size <= MAX_BATCH; size++)
+    {
+        const uint64_t n = batchSizes[size].load(std::memory_order_relaxed);
+        if (n > 0)
+        {
+            out << "  batch " << size << (size == MAX_BATCH ? "+" : "") << ": " << n << std::endl;
+        }
+    }
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include "OutputBackend.h"
+
+// Collects the synthetic input one thread produces during a unit of work (one key event on
+// the engine thread, one Update() on the physics thread) and sends it as a single batch.
+//
+// Open a Scope around the work; every InputSimulator call inside it is appended to the
+// calling thread's batch instead of going to the OS, consecutive relative moves (and
+// consecutive wheel events) are merged into one, and the outermost Scope's destructor
+// hands the whole batch, in order, to the backend. Outside a Scope each event is
+// submitted on its own, as before.
+//
+// The batch lives in thread-local storage and never allocates.
+class InjectionBatcher
+{
+public:
+    static constexpr size_t MAX_BATCH = 64;
+
+    class Scope
+    {
+    public:
+        Scope() { depth++; }
+        ~Scope()
+        {
+            if (--depth == 0)
+            {
+                flush();
+            }
+        }
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+    };
+
+    // Where flushed batches go. Set once at startup, before any thread injects.
+    static void setBackend(OutputBackend *output) { backend.store(output, std::memory_order_release); }
+    static OutputBackend *getBackend() { return backend.load(std::memory_order_acquire); }
+
+    static bool cursorPosition(int &x, int &y)
+    {
+        OutputBackend *output = getBackend();
+        return output != nullptr && output->cursorPosition(x, y);
+    }
+
+    static void emit(const OutputEvent &event);
+    // Append a pre-built sequence (a macro) in one copy. Sequences longer than a batch
+    // flush what is pending and go to the backend in a single submit of their own.
+    static void emitAll(const OutputEvent *sequence, size_t count);
+    static void flush();
+
+    // Submit calls (one SendInput each on Windows), events sent, moves and scrolls merged away.
+    static uint64_t submitCount() { return submits.load(std::memory_order_relaxed); }
+    static uint64_t eventCount() { return events.load(std::memory_order_relaxed); }
+    static uint64_t mergedCount() { return merged.load(std::memory_order_relaxed); }
+
+    // Batch-size distribution and submit rate over 'elapsedNanos'.
+    static void report(std::ostream &out, uint64_t elapsedNanos);
+
+private:
+    struct Batch
+    {
+        OutputEvent events[MAX_BATCH];
+        size_t count;
+    };
+
+    static void submit(const OutputEvent *batch, size_t count);
+
+    static std::atomic<OutputBackend *> backend;
+    static thread_local Batch pending;
+    static thread_local int depth;
+
+    static std::atomic<uint64_t> submits;
+    static std::atomic<uint64_t> events;
+    static std::atomic<uint64_t> merged;
+    // batchSizes[n] counts submits of n events; [MAX_BATCH] also holds anything larger.
+    static std::atomic<uint64_t> batchSizes[MAX_BATCH + 1];
+};
@@ -0,0 +1,129 @@
+#include "InjectionQueue.h"
+#include "HookStats.h"
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+void InjectionQueue::start(OutputBackend *output)
+{
+    downstream = output;
+    running = true;
+    injector = std::thread(&InjectionQueue::injectorThread, this);
+}
+
+void InjectionQueue::stop()
+{
+    if (!injector.joinable())
+    {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+    }
+    wakeup.notify_one();
+    injector.join();
+}
+
+void InjectionQueue::flush()
+{
+    const uint64_t target = queued.load(std::memory_order_acquire);
+    std::unique_lock<std::mutex> lock(mutex);
+    drained.wait(lock, [&]
+                 { return injected.load(std::memory_order_acquire) >= target || !injector.joinable(); });
+}
+
+void InjectionQueue::submit(const OutputEvent *events, size_t count)
+{
+    while (count > 0)
+    {
+        const size_t n = count < InjectionBatcher::MAX_BATCH ? count : InjectionBatcher::MAX_BATCH;
+        const uint64_t now = EventClock::now();
+        auto fill = [&](Batch &batch)
+        {
+            batch.enqueuedAt = now;
+            batch.count = n;
+            for (size_t i = 0; i < n; i++)
+            {
+                batch.events[i] = events[i];
+            }
+        };
+        if (!queue.tryPush(fill))
+        {
+            full.fetch_add(1, std::memory_order_relaxed);
+            wake();
+            while (!queue.tryPush(fill))
+            {
+                std::this_thread::yield();
+            }
+        }
+        queued.fetch_add(1, std::memory_order_release);
+        const uint64_t depthNow = queue.size();
+        uint64_t seen = depthHighWater.load(std::memory_order_relaxed);
+        while (depthNow > seen && !depthHighWater.compare_exchange_weak(seen, depthNow, std::memory_order_relaxed))
+        {
+        }
+        events += n;
+        count -= n;
+    }
+    wake();
+}
+
+void InjectionQueue::wake()
+{
+    // Pairs with the store to 'parked' in injectorThread: either we see it parked, or it
+    // sees our batch before it goes to sleep.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (parked.load(std::memory_order_seq_cst))
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        wakeup.notify_one();
+    }
+}
+
+void InjectionQueue::injectorThread()
+{
+#ifdef _WIN32
+    // Injected input should go out ahead of ordinary work, but below the hook thread's
+    // own message loop, which Windows already boosts while input is pending.
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_ABOVE_NORMAL);
+#endif
+    for (;;)
+    {
+        bool any = false;
+        while (queue.tryPop([&](Batch &batch)
+                            {
+                                HookStats::record(HookStats::INJECTION_QUEUE, batch.enqueuedAt, EventClock::now());
+                                downstream->submit(batch.events, batch.count); }))
+        {
+            injected.fetch_add(1, std::memory_order_release);
+            any = true;
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        if (any)
+        {
+            drained.notify_all();
+        }
+        if (!running && queue.empty())
+        {
+            break;
+        }
+        parked.store(true, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (queue.empty() && running)
+        {
+            // No timeout: producers and stop() always wake us, so an idle queue costs nothing.
+            wakeup.wait(lock, [this]
+                        { return !queue.empty() || !running; });
+            wakeups.fetch_add(1, std::memory_order_relaxed);
+        }
+        parked.store(false, std::memory_order_relaxed);
+    }
+    drained.notify_all();
+}
+
+void InjectionQueue::report(std::ostream &out) const
+{
+    out << "Injection queue: high-water mark " << highWaterMark() << " of " << CAPACITY
+        << ", full " << fullCount() << " times, injector woke " << wakeupCount() << " times" << std::endl;
+}
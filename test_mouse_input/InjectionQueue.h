@@ -0,0 +1,74 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include "InjectionBatcher.h"
+#include "MpscQueue.h"
+
+// Hands injected input to a dedicated injector thread.
+//
+// InjectionQueue is itself an OutputBackend: InjectionBatcher flushes into it from the
+// engine and physics threads, each batch is copied into a bounded MPSC queue, and the
+// injector thread (raised above normal priority) forwards batches to the real backend in
+// the order they were queued. No thread that reacts to keys ever waits on SendInput.
+//
+// Enqueue-to-inject time goes to HookStats::INJECTION_QUEUE. If the queue is full the
+// producer yields until the injector makes room; input is never dropped.
+class InjectionQueue : public OutputBackend
+{
+public:
+    static constexpr size_t CAPACITY = 64;
+
+    ~InjectionQueue() { stop(); }
+
+    // Start the injector thread, forwarding everything to 'output'.
+    void start(OutputBackend *output);
+    // Inject everything already queued, then end the thread.
+    void stop();
+    // Block until every batch queued before this call has reached the backend.
+    void flush();
+
+    void submit(const OutputEvent *events, size_t count) override;
+    bool cursorPosition(int &x, int &y) override { return downstream != nullptr && downstream->cursorPosition(x, y); }
+
+    size_t depth() const { return queue.size(); }
+    uint64_t highWaterMark() const { return depthHighWater.load(std::memory_order_relaxed); }
+    // Times a producer found the queue full and had to wait.
+    uint64_t fullCount() const { return full.load(std::memory_order_relaxed); }
+    // Times the injector thread woke from its wait; with nothing queued it stays asleep.
+    uint64_t wakeupCount() const { return wakeups.load(std::memory_order_relaxed); }
+
+    void report(std::ostream &out) const;
+
+private:
+    struct Batch
+    {
+        uint64_t enqueuedAt; // EventClock ns
+        size_t count;
+        OutputEvent events[InjectionBatcher::MAX_BATCH];
+    };
+
+    void injectorThread();
+    void wake();
+
+    MpscQueue<Batch, CAPACITY> queue;
+    OutputBackend *downstream = nullptr;
+    std::thread injector;
+    std::atomic<bool> running{false};
+
+    std::atomic<uint64_t> queued{0};
+    std::atomic<uint64_t> injected{0};
+    std::atomic<uint64_t> depthHighWater{0};
+    std::atomic<uint64_t> full{0};
+    std::atomic<uint64_t> wakeups{0};
+
+    // The injector sleeps on 'wakeup' only when the queue is empty; producers take the
+    // mutex only if they see it parked.
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    std::condition_variable drained;
+    std::atomic<bool> parked{false};
+};
@@ -1,74 +1,70 @@
 #pragma once
-#include <iostream>
-#include <windows.h>
+#include "InjectionBatcher.h"
 
+// Synthetic input helpers. Each call becomes an OutputEvent for the calling thread's
+// InjectionBatcher; inside an InjectionBatcher::Scope nothing reaches the OS until the
+// scope closes, and then the whole batch goes out in one call.
 class InputSimulator
 {
 public:
     // ---------------------------------------------
     // Static Functions to simulate mouse actions
 
+    // Current pointer position, as reported by the output backend.
+    static bool cursorPosition(int &x, int &y) {
+        return InjectionBatcher::cursorPosition(x, y);
+    }
+
     static void moveMouse(int dx, int dy) {
-        INPUT input = { 0 };
-        input.type = INPUT_MOUSE;
-        input.mi.dx = dx;
-        input.mi.dy = dy;
-        input.mi.dwFlags = MOUSEEVENTF_MOVE;
-        SendInput(1, &input, sizeof(INPUT));
+        InjectionBatcher::emit(OutputEvent::move(dx, dy));
+    }
+
+    // Absolute move to a virtual-desktop pixel.
+    static void moveMouseTo(int x, int y) {
+        InjectionBatcher::emit(OutputEvent::moveTo(x, y));
+    }
+
+    // Wheel deltas in WHEEL_DELTA units (120 per notch); dy > 0 scrolls up, dx > 0 right.
+    static void scrollWheel(int dx, int dy) {
+        InjectionBatcher::emit(OutputEvent::wheel(dx, dy));
     }
 
     static void simulateLeftDown() {
-        INPUT input = { 0 };
-        input.type = INPUT_MOUSE;
-        input.mi.dwFlags = MOUSEEVENTF_LEFTDOWN;
-        SendInput(1, &input, sizeof(INPUT));
+        InjectionBatcher::emit(OutputEvent::mouseButton(MOUSE_LEFT, true));
     }
 
     static void simulateLeftUp() {
-        INPUT input = { 0 };
-        input.type = INPUT_MOUSE;
-        input.mi.dwFlags = MOUSEEVENTF_LEFTUP;
-        SendInput(1, &input, sizeof(INPUT));
+        InjectionBatcher::emit(OutputEvent::mouseButton(MOUSE_LEFT, false));
     }
 
     static void simulateRightDown() {
-        INPUT input = { 0 };
-        input.type = INPUT_MOUSE;
-        input.mi.dwFlags = MOUSEEVENTF_RIGHTDOWN;
-        SendInput(1, &input, sizeof(INPUT));
+        InjectionBatcher::emit(OutputEvent::mouseButton(MOUSE_RIGHT, true));
     }
 
     static void simulateRightUp() {
-        INPUT input = { 0 };
-        input.type = INPUT_MOUSE;
-        input.mi.dwFlags = MOUSEEVENTF_RIGHTUP;
-        SendInput(1, &input, sizeof(INPUT));
+        InjectionBatcher::emit(OutputEvent::mouseButton(MOUSE_RIGHT, false));
     }
 
     static void simulateMiddleDown() {
-        INPUT input = { 0 };
-        input.type = INPUT_MOUSE;
-        input.mi.dwFlags = MOUSEEVENTF_MIDDLEDOWN;
-        SendInput(1, &input, sizeof(INPUT));
+        InjectionBatcher::emit(OutputEvent::mouseButton(MOUSE_MIDDLE, true));
     }
 
     static void simulateMiddleUp() {
-        INPUT input = { 0 };
-        input.type = INPUT_MOUSE;
-        input.mi.dwFlags = MOUSEEVENTF_MIDDLEUP;
-        SendInput(1, &input, sizeof(INPUT));
+        InjectionBatcher::emit(OutputEvent::mouseButton(MOUSE_MIDDLE, false));
+    }
+
+    static void keyDown(int vk_code) {
+        InjectionBatcher::emit(OutputEvent::key(vk_code, true));
+    }
+
+    static void keyUp(int vk_code) {
+        InjectionBatcher::emit(OutputEvent::key(vk_code, false));
     }
 
     // Simulate a key tap by sending a key down followed by a key up for the given VK code.
     static void simulateKeyTap(int vk_code) {
-        INPUT inputs[2] = {};
-        // Key down event
-        inputs[0].type = INPUT_KEYBOARD;
-        inputs[0].ki.wVk = vk_code;
-        // Key up event
-        inputs[1].type = INPUT_KEYBOARD;
-        inputs[1].ki.wVk = vk_code;
-        inputs[1].ki.dwFlags = KEYEVENTF_KEYUP;
-        SendInput(2, inputs, sizeof(INPUT));
+        InjectionBatcher::Scope batch;
+        InjectionBatcher::emit(OutputEvent::key(vk_code, true));
+        InjectionBatcher::emit(OutputEvent::key(vk_code, false));
     }
 };
@@ -0,0 +1,114 @@
+#include "KeyEngine.h"
+#include "AllocationGuard.h"
+#include "HookStats.h"
+#include "InjectionBatcher.h"
+#include "KeyState.h"
+#include "TapHistory.h"
+#include "ModeManager.h"
+
+WakeSignal KeyEngine::tickWake;
+std::atomic<uint64_t> KeyEngine::wakeups{0};
+
+void KeyEngine::updateKeyState(int vkCode, bool isDown, uint64_t timestamp)
+{
+    if (isDown)
+    {
+        keyStates.press(vkCode, timestamp);
+    }
+    else
+    {
+        keyStates.release(vkCode, timestamp);
+    }
+}
+
+void KeyEngine::processKeyEvent(const KeyEvent &event)
+{
+    AllocationGuard::Scope hotPath;
+    // Whatever the handlers inject for this event goes out in one SendInput.
+    InjectionBatcher::Scope batch;
+    int vkCode = event.vkCode;
+    uint64_t timestamp = event.timestamp;
+    bool isDown = event.isDown();
+    if (isDown)
+    {
+        keyTaps.record(vkCode, timestamp);
+    }
+    if (event.isBypass())
+    {
+        // The hook skipped a degraded mode for this event; drop ours too so both sides agree.
+        Mode::endCurrentMode();
+        updateKeyState(vkCode, isDown, timestamp);
+        return;
+    }
+    uint64_t start = HookStats::now();
+    bool handled = isDown ? Mode::checkIfActivatesMode(vkCode) : Mode::checkActiveModeEnded(vkCode, timestamp);
+    uint64_t activated = HookStats::now();
+    HookStats::record(HookStats::MODE_ACTIVATION, start, activated);
+    if (!handled && Mode::currentMode != nullptr)
+    {
+        if (isDown)
+        {
+            Mode::currentMode->handleKeyDownEvent(vkCode, timestamp);
+        }
+        else
+        {
+            Mode::currentMode->handleKeyUpEvent(vkCode, timestamp);
+        }
+        uint64_t modeHandled = HookStats::now();
+        HookStats::record(HookStats::MODE_HANDLING, activated, modeHandled);
+        activated = modeHandled;
+    }
+    updateKeyState(vkCode, isDown, timestamp);
+    HookStats::record(HookStats::KEY_STATE_UPDATE, activated, HookStats::now());
+    // A motion or scroll key: the polling thread may be asleep, and now has work.
+    Mode *mode = Mode::currentMode;
+    if (isDown && mode != nullptr && mode->actionFor(vkCode).needsTicks())
+    {
+        tickWake.notify();
+    }
+}
+
+void KeyEngine::fireRepeats()
+{
+    const uint64_t now = EventClock::now();
+    if (Mode::repeater.nextDue() > now)
+    {
+        return;
+    }
+    AllocationGuard::Scope hotPath;
+    InjectionBatcher::Scope batch;
+    Mode::repeater.fire(now);
+}
+
+uint64_t KeyEngine::tick()
+{
+    // Read once: the engine thread may switch modes while we run.
+    Mode *mode = Mode::currentMode;
+    if (mode == nullptr)
+    {
+        return NO_TICK;
+    }
+    AllocationGuard::Scope hotPath;
+    InjectionBatcher::Scope batch;
+    mode->Update();
+    return mode->needsTicks() ? mode->updateInterval() : NO_TICK;
+}
+
+void KeyEngine::report(std::ostream &out, uint64_t startTime)
+{
+    // Only the thread printing reports touches these.
+    static uint64_t lastTime = 0;
+    static uint64_t lastCount = 0;
+    const uint64_t now = EventClock::now();
+    const uint64_t count = wakeupCount();
+    const uint64_t since = lastTime != 0 ? lastTime : startTime;
+    const double seconds = static_cast<double>(now - since) / EventClock::SECOND;
+    out << "Engine: " << count << " wakeups";
+    if (seconds > 0)
+    {
+        out << ", " << static_cast<double>(count - lastCount) / seconds << " per second over the last " << seconds << " s";
+    }
+    out << std::endl;
+    lastTime = now;
+    lastCount = count;
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include "HookCapture.h"
+#include "WakeSignal.h"
+
+// The mode pipeline, independent of where events come from and where output goes.
+// The live app calls processKeyEvent() from the engine thread and tick() from the polling
+// thread; replay calls both from one thread under a VirtualClock.
+class KeyEngine
+{
+public:
+    // Mode activation, the active mode's handlers and the key state update for one
+    // captured event. Whatever the handlers inject goes out as one batch.
+    static void processKeyEvent(const KeyEvent &event);
+
+    // One Update() of the active mode, if any. Returns how long to wait before the next
+    // tick: the mode's update interval, or NO_TICK when no mode is active or the active
+    // one has nothing moving. The polling thread then sleeps on tickWake, which
+    // processKeyEvent() signals when a key starts something that needs ticks.
+    static uint64_t tick();
+
+    // Send the current key repeat if it is due (see KeyRepeater). Engine thread.
+    static void fireRepeats();
+
+    static void updateKeyState(int vkCode, bool isDown, uint64_t timestamp);
+
+    static constexpr uint64_t NO_TICK = WakeSignal::FOREVER;
+    static WakeSignal tickWake;
+
+    // Every time the engine or polling thread wakes up, for the idle-cost figure in report().
+    static void countWakeup() { wakeups.fetch_add(1, std::memory_order_relaxed); }
+    static uint64_t wakeupCount() { return wakeups.load(std::memory_order_relaxed); }
+    // Wakeups per second since the previous report (or since 'startTime').
+    static void report(std::ostream &out, uint64_t startTime);
+
+private:
+    static std::atomic<uint64_t> wakeups;
+};
@@ -0,0 +1,50 @@
+#include "KeyRepeater.h"
+#include "InputSimulator.h"
+#include "OutputKeyTable.h"
+
+void KeyRepeater::start(int source, const KeyAction &newAction, const Settings &settings, uint64_t pressedAt)
+{
+    const bool repeats = newAction.kind == KeyActionKind::Remap ||
+                         (newAction.kind == KeyActionKind::MouseButton && settings.mouseButtons);
+    if (!repeats || !settings.enabled())
+    {
+        // A new press stops the previous key repeating, as it does with the OS repeat.
+        repeating = 0;
+        return;
+    }
+    repeating = source;
+    action = newAction;
+    interval = settings.interval;
+    due = pressedAt + settings.delay;
+}
+
+void KeyRepeater::fire(uint64_t now)
+{
+    if (repeating == 0 || now < due)
+    {
+        return;
+    }
+    if (action.kind == KeyActionKind::Remap)
+    {
+        // Only while the remap still holds its output down.
+        if (pressedOutputs.outputFor(repeating) != action.target)
+        {
+            repeating = 0;
+            return;
+        }
+        InputSimulator::keyDown(action.target);
+    }
+    else
+    {
+        const MouseButton button = static_cast<MouseButton>(action.target);
+        InjectionBatcher::emit(OutputEvent::mouseButton(button, false));
+        InjectionBatcher::emit(OutputEvent::mouseButton(button, true));
+    }
+    repeats++;
+    due += interval;
+    // After a stall, carry on from now rather than sending a burst to catch up.
+    if (due <= now)
+    {
+        due = now + interval;
+    }
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+#include "DispatchTable.h"
+#include "EventClock.h"
+
+// Our own key repeat, replacing the OS autorepeat that the hook now drops (see
+// HookCapture::filterRepeat). Like the OS, only the most recently pressed key repeats;
+// releasing it, or ending the mode, stops the repeat.
+//
+// Lives on the engine thread: the mode handlers start and stop it while processing events,
+// and the engine loop sleeps until nextDue() and then calls fire(), so the cadence follows
+// the mode's settings rather than the keyboard control panel or how busy the hook is.
+class KeyRepeater
+{
+public:
+    struct Settings
+    {
+        uint64_t delay = 500 * EventClock::MILLISECOND;  // first repeat after this long
+        uint64_t interval = 33 * EventClock::MILLISECOND; // then one per interval (~30 Hz)
+        bool mouseButtons = false;                        // auto-click held mouse-button keys
+
+        bool enabled() const { return interval != 0; }
+    };
+
+    static constexpr uint64_t NEVER = UINT64_MAX;
+
+    // 'source' was pressed and does 'action'; repeat it if the settings allow.
+    void start(int source, const KeyAction &action, const Settings &settings, uint64_t pressedAt);
+    // 'source' was released.
+    void stop(int source)
+    {
+        if (source == repeating)
+        {
+            repeating = 0;
+        }
+    }
+    void stopAll() { repeating = 0; }
+
+    // When the next repeat is due, or NEVER.
+    uint64_t nextDue() const { return repeating != 0 ? due : NEVER; }
+    // Send the repeat if it is due at 'now'.
+    void fire(uint64_t now);
+
+    uint64_t repeatCount() const { return repeats; }
+
+private:
+    int repeating = 0;
+    KeyAction action;
+    uint64_t interval = 0;
+    uint64_t due = 0;
+    uint64_t repeats = 0;
+};
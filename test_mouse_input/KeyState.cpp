@@ -1,4 +1,3 @@
 #include "KeyState.h"
 
-std::unordered_map<int, KeyState> keyStates;
-std::mutex keyStatesMutex;
+KeyStateTable keyStates;
@@ -1,22 +1,164 @@
 #pragma once
-#include <unordered_map>
-#include <mutex>
-#include <windows.h>
+#include <atomic>
+#include <cstdint>
+#include "EventClock.h"
+#include "SeqLock.h"
 
+// A copy of one key's state, as returned by KeyStateTable::get().
 struct KeyState {
-    int vkCode = 0;
-    std::string name = "no name";
-    DWORD timePressed = 0;
-    int timeout = 200;
     bool held = false;
-        // Timestamp when the key was first pressed.
-    DWORD timeReleased = 0;
-    
-    
-    
-    
+    uint32_t tapCount = 0;     // number of presses seen since startup
+    uint64_t timePressed = 0;  // EventClock ns of the most recent press
+    uint64_t timeReleased = 0; // EventClock ns of the most recent release
 };
 
-// Declare the global keyStates dictionary and its mutex as extern
-extern std::unordered_map<int, KeyState> keyStates;
-extern std::mutex keyStatesMutex;
+// One bit per virtual-key code.
+struct KeyBitmap
+{
+    uint64_t words[4] = {};
+
+    void set(int vkCode) { words[(vkCode & 0xFF) >> 6] |= 1ull << (vkCode & 63); }
+    bool test(int vkCode) const { return (words[(vkCode & 0xFF) >> 6] >> (vkCode & 63)) & 1; }
+
+    // How many of the keys in 'mask' are set here.
+    int countIn(const KeyBitmap &mask) const
+    {
+        int count = 0;
+        for (int i = 0; i < 4; i++)
+        {
+            uint64_t bits = words[i] & mask.words[i];
+            while (bits != 0)
+            {
+                bits &= bits - 1;
+                count++;
+            }
+        }
+        return count;
+    }
+};
+
+// A consistent picture of every key at one instant, from KeyStateTable::snapshot().
+struct KeySnapshot
+{
+    uint64_t version = 0; // changes whenever any key changes
+    KeyBitmap held;
+    uint64_t timePressed[256] = {};
+};
+
+// Fixed-size table of per-key state indexed by virtual-key code, replacing the old
+// unordered_map + mutex. Every slot is a few atomics, so readers (the hook, the modes,
+// the physics thread) never block and nothing allocates after startup.
+//
+// Writes come from the engine thread only. A writer stores the timestamps first and
+// publishes the held bit last (release), so a reader that sees a key held also sees
+// the press time that goes with it. Each write is also bracketed by a seqlock, so
+// snapshot() can copy the whole table without ever making the writer wait.
+class KeyStateTable
+{
+public:
+    static constexpr int KEY_COUNT = 256;
+
+    // Record a press. Returns false if the key was already held (an autorepeat).
+    bool press(int vkCode, uint64_t timestamp)
+    {
+        Slot &slot = slots[vkCode & 0xFF];
+        uint32_t state = slot.state.load(std::memory_order_relaxed);
+        if (state & HELD_BIT)
+        {
+            return false;
+        }
+        lock.beginWrite();
+        slot.timePressed.store(timestamp, std::memory_order_relaxed);
+        std::atomic<uint64_t> &word = heldWords[(vkCode & 0xFF) >> 6];
+        word.store(word.load(std::memory_order_relaxed) | (1ull << (vkCode & 63)), std::memory_order_relaxed);
+        slot.state.store((state + TAP_INCREMENT) | HELD_BIT, std::memory_order_release);
+        lock.endWrite();
+        return true;
+    }
+
+    // Record a release. Returns false if the key wasn't held.
+    bool release(int vkCode, uint64_t timestamp)
+    {
+        Slot &slot = slots[vkCode & 0xFF];
+        uint32_t state = slot.state.load(std::memory_order_relaxed);
+        if ((state & HELD_BIT) == 0)
+        {
+            return false;
+        }
+        lock.beginWrite();
+        slot.timeReleased.store(timestamp, std::memory_order_relaxed);
+        std::atomic<uint64_t> &word = heldWords[(vkCode & 0xFF) >> 6];
+        word.store(word.load(std::memory_order_relaxed) & ~(1ull << (vkCode & 63)), std::memory_order_relaxed);
+        slot.state.store(state & ~HELD_BIT, std::memory_order_release);
+        lock.endWrite();
+        return true;
+    }
+
+    bool isHeld(int vkCode) const
+    {
+        return (slots[vkCode & 0xFF].state.load(std::memory_order_acquire) & HELD_BIT) != 0;
+    }
+
+    uint64_t timePressed(int vkCode) const
+    {
+        return slots[vkCode & 0xFF].timePressed.load(std::memory_order_acquire);
+    }
+
+    uint64_t timeReleased(int vkCode) const
+    {
+        return slots[vkCode & 0xFF].timeReleased.load(std::memory_order_acquire);
+    }
+
+    // All fields of one key. Each field is read atomically, but a write landing between
+    // the reads can mix the old press time with the new held bit and so on.
+    KeyState get(int vkCode) const
+    {
+        const Slot &slot = slots[vkCode & 0xFF];
+        KeyState result;
+        uint32_t state = slot.state.load(std::memory_order_acquire);
+        result.held = (state & HELD_BIT) != 0;
+        result.tapCount = state / TAP_INCREMENT;
+        result.timePressed = slot.timePressed.load(std::memory_order_relaxed);
+        result.timeReleased = slot.timeReleased.load(std::memory_order_relaxed);
+        return result;
+    }
+
+    // Copy the held bitmap and every press time as of one instant. Only retries if the
+    // engine thread writes while the copy is being taken.
+    void snapshot(KeySnapshot &out) const
+    {
+        uint64_t start;
+        do
+        {
+            start = lock.readBegin();
+            for (int i = 0; i < 4; i++)
+            {
+                out.held.words[i] = heldWords[i].load(std::memory_order_relaxed);
+            }
+            for (int vk = 0; vk < KEY_COUNT; vk++)
+            {
+                out.timePressed[vk] = slots[vk].timePressed.load(std::memory_order_relaxed);
+            }
+        } while (lock.readRetry(start));
+        out.version = start;
+    }
+
+private:
+    static constexpr uint32_t HELD_BIT = 1;
+    static constexpr uint32_t TAP_INCREMENT = 2;
+
+    // 20 bytes of state padded to 32, so two keys share a cache line and no slot straddles one.
+    struct alignas(32) Slot
+    {
+        std::atomic<uint64_t> timePressed{0};
+        std::atomic<uint64_t> timeReleased{0};
+        std::atomic<uint32_t> state{0}; // bit 0: held, bits 1..31: tap count
+    };
+
+    alignas(64) Slot slots[KEY_COUNT];
+    alignas(64) SeqLock lock;
+    std::atomic<uint64_t> heldWords[4] = {};
+};
+
+// The global key state table, updated by the engine thread.
+extern KeyStateTable keyStates;
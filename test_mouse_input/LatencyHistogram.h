@@ -0,0 +1,145 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// A fixed-memory log-linear histogram (the HdrHistogram layout) of nanosecond durations.
+// Values below 2^SUB_BUCKET_BITS are counted exactly; above that every power of two is
+// split into 2^SUB_BUCKET_BITS linear sub-buckets, so any reported value is within ~3%
+// of the true one. record() is a bit scan, a shift and one relaxed atomic add: it never
+// allocates or locks, so it is safe to call from the hook and from several threads at once.
+class LatencyHistogram
+{
+public:
+    static constexpr int SUB_BUCKET_BITS = 5;
+    static constexpr uint64_t SUB_BUCKET_COUNT = 1ull << SUB_BUCKET_BITS;
+    // Values with a highest set bit above this are clamped into the last bucket (~9 minutes).
+    static constexpr int MAX_MSB = 39;
+    static constexpr size_t BUCKET_COUNT = (MAX_MSB - SUB_BUCKET_BITS + 2) * SUB_BUCKET_COUNT;
+
+    void record(uint64_t nanos)
+    {
+        buckets_[bucketIndex(nanos)].fetch_add(1, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+        uint64_t seen = max_.load(std::memory_order_relaxed);
+        while (nanos > seen && !max_.compare_exchange_weak(seen, nanos, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    uint64_t max() const { return max_.load(std::memory_order_relaxed); }
+
+    // The smallest recorded bucket value v such that at least 'percentile' percent of
+    // samples are <= v. Returns 0 if nothing has been recorded.
+    uint64_t percentile(double percentile) const
+    {
+        const uint64_t total = count();
+        if (total == 0)
+        {
+            return 0;
+        }
+        uint64_t threshold = static_cast<uint64_t>(percentile / 100.0 * static_cast<double>(total) + 0.5);
+        if (threshold < 1)
+        {
+            threshold = 1;
+        }
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BUCKET_COUNT; i++)
+        {
+            seen += buckets_[i].load(std::memory_order_relaxed);
+            if (seen >= threshold)
+            {
+                const uint64_t upper = bucketUpperBound(i);
+                const uint64_t highest = max();
+                return upper < highest ? upper : highest;
+            }
+        }
+        return max();
+    }
+
+    // Add every sample of 'other' (e.g. a per-thread histogram into a total). Like
+    // record(), safe while either histogram is being recorded into; the result then
+    // includes some or all of those samples.
+    void merge(const LatencyHistogram &other)
+    {
+        for (size_t i = 0; i < BUCKET_COUNT; i++)
+        {
+            const uint64_t samples = other.buckets_[i].load(std::memory_order_relaxed);
+            if (samples != 0)
+            {
+                buckets_[i].fetch_add(samples, std::memory_order_relaxed);
+            }
+        }
+        count_.fetch_add(other.count(), std::memory_order_relaxed);
+        const uint64_t otherMax = other.max();
+        uint64_t seen = max_.load(std::memory_order_relaxed);
+        while (otherMax > seen && !max_.compare_exchange_weak(seen, otherMax, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    void reset()
+    {
+        for (auto &bucket : buckets_)
+        {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+        count_.store(0, std::memory_order_relaxed);
+        max_.store(0, std::memory_order_relaxed);
+    }
+
+    static size_t bucketIndex(uint64_t value)
+    {
+        if (value < SUB_BUCKET_COUNT)
+        {
+            return static_cast<size_t>(value);
+        }
+        int msb = highestBit(value);
+        if (msb > MAX_MSB)
+        {
+            return BUCKET_COUNT - 1;
+        }
+        const int shift = msb - SUB_BUCKET_BITS;
+        return static_cast<size_t>((shift + 1) * SUB_BUCKET_COUNT + ((value >> shift) - SUB_BUCKET_COUNT));
+    }
+
+    // Largest value that maps to bucket 'index'.
+    static uint64_t bucketUpperBound(size_t index)
+    {
+        if (index < SUB_BUCKET_COUNT)
+        {
+            return index;
+        }
+        const int shift = static_cast<int>(index / SUB_BUCKET_COUNT) - 1;
+        const uint64_t subBucket = index % SUB_BUCKET_COUNT + SUB_BUCKET_COUNT;
+        return ((subBucket + 1) << shift) - 1;
+    }
+
+private:
+    static int highestBit(uint64_t value)
+    {
+#if defined(_MSC_VER) && defined(_M_X64)
+        unsigned long index;
+        _BitScanReverse64(&index, value);
+        return static_cast<int>(index);
+#elif defined(_MSC_VER)
+        unsigned long index;
+        if (_BitScanReverse(&index, static_cast<unsigned long>(value >> 32)))
+        {
+            return static_cast<int>(index) + 32;
+        }
+        _BitScanReverse(&index, static_cast<unsigned long>(value));
+        return static_cast<int>(index);
+#else
+        return 63 - __builtin_clzll(value);
+#endif
+    }
+
+    std::atomic<uint64_t> buckets_[BUCKET_COUNT] = {};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> max_{0};
+};
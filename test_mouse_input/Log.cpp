@@ -0,0 +1,192 @@
+#include "Log.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "HookStats.h"
+#include "WakeSignal.h"
+
+Log::Ring Log::rings[Log::MAX_THREADS];
+std::atomic<int> Log::ringsClaimed{0};
+std::atomic<uint64_t> Log::dropped{0};
+std::atomic<bool> Log::running{false};
+std::atomic<uint64_t> Log::wakeups{0};
+
+namespace
+{
+    thread_local Log::Ring *threadRing = nullptr;
+    thread_local bool threadRingUnavailable = false;
+    std::thread formatter;
+    // The formatter sleeps on this while nothing is being logged.
+    WakeSignal formatterWake;
+    uint64_t startTime = 0;
+    // Strings handed out by intern(); a deque never moves its elements.
+    std::mutex internedLock;
+    std::deque<std::string> interned;
+
+    const char *levelName(int level)
+    {
+        switch (level)
+        {
+        case LOG_LEVEL_DEBUG:
+            return "DEBUG";
+        case LOG_LEVEL_INFO:
+            return "INFO ";
+        case LOG_LEVEL_WARN:
+            return "WARN ";
+        default:
+            return "ERROR";
+        }
+    }
+}
+
+const char *Log::intern(const std::string &text)
+{
+    std::lock_guard<std::mutex> lock(internedLock);
+    interned.push_back(text);
+    return interned.back().c_str();
+}
+
+uint64_t Log::now()
+{
+    return HookStats::now();
+}
+
+void Log::push(const LogRecord &record)
+{
+    if (threadRing == nullptr)
+    {
+        if (threadRingUnavailable)
+        {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        int index = ringsClaimed.fetch_add(1, std::memory_order_relaxed);
+        if (index >= MAX_THREADS)
+        {
+            threadRingUnavailable = true;
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        threadRing = &rings[index];
+    }
+    if (!threadRing->push(record))
+    {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+    // Cheap unless the formatter is parked, i.e. only for the first record after a quiet spell.
+    formatterWake.notify();
+}
+
+void Log::format(const LogRecord &record, std::string &out)
+{
+    char buffer[64];
+    uint64_t sinceStart = record.timestamp > startTime ? record.timestamp - startTime : 0;
+    snprintf(buffer, sizeof(buffer), "[%10.3f] %s ", sinceStart / 1e9, levelName(record.level));
+    out += buffer;
+
+    int arg = 0;
+    for (const char *p = record.format; *p != '\0'; p++)
+    {
+        if (p[0] == '{' && p[1] == '}' && arg < record.argCount)
+        {
+            const LogRecord::Arg &value = record.args[arg];
+            switch (record.types[arg])
+            {
+            case LogRecord::ARG_INT:
+                snprintf(buffer, sizeof(buffer), "%lld", static_cast<long long>(value.i));
+                break;
+            case LogRecord::ARG_UINT:
+                snprintf(buffer, sizeof(buffer), "%llu", static_cast<unsigned long long>(value.u));
+                break;
+            case LogRecord::ARG_DOUBLE:
+                snprintf(buffer, sizeof(buffer), "%g", value.d);
+                break;
+            case LogRecord::ARG_CHAR:
+                snprintf(buffer, sizeof(buffer), "%c", static_cast<char>(value.i));
+                break;
+            case LogRecord::ARG_STRING:
+                buffer[0] = '\0';
+                out += value.s != nullptr ? value.s : "(null)";
+                break;
+            }
+            out += buffer;
+            arg++;
+            p++;
+        }
+        else
+        {
+            out += *p;
+        }
+    }
+    out += '\n';
+}
+
+void Log::formatterThread()
+{
+    std::vector<LogRecord> batch;
+    std::string text;
+    bool keepGoing = true;
+    while (keepGoing)
+    {
+        // Check before draining so the final pass after stop() catches everything.
+        keepGoing = running.load(std::memory_order_acquire);
+        batch.clear();
+        int claimed = std::min(ringsClaimed.load(std::memory_order_acquire), static_cast<int>(MAX_THREADS));
+        LogRecord record;
+        for (int i = 0; i < claimed; i++)
+        {
+            while (rings[i].pop(record))
+            {
+                batch.push_back(record);
+            }
+        }
+        if (batch.empty())
+        {
+            // Nothing is being logged: sleep until the next record (or stop()), so an idle
+            // app stays idle.
+            if (keepGoing)
+            {
+                formatterWake.wait();
+                wakeups.fetch_add(1, std::memory_order_relaxed);
+            }
+            continue;
+        }
+        // Each ring is in order already; interleave the threads by timestamp.
+        std::stable_sort(batch.begin(), batch.end(), [](const LogRecord &a, const LogRecord &b)
+                         { return a.timestamp < b.timestamp; });
+        text.clear();
+        for (const LogRecord &entry : batch)
+        {
+            format(entry, text);
+        }
+        fwrite(text.data(), 1, text.size(), stdout);
+        fflush(stdout);
+        // While records keep coming, collect them for a millisecond at a time rather than
+        // being woken for each one.
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+void Log::start()
+{
+    if (running.exchange(true))
+    {
+        return;
+    }
+    startTime = now();
+    formatter = std::thread(formatterThread);
+}
+
+void Log::stop()
+{
+    if (!running.exchange(false))
+    {
+        return;
+    }
+    formatterWake.notify();
+    formatter.join();
+}
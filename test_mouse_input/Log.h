@@ -0,0 +1,152 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include "EventRing.h"
+
+// Asynchronous binary logger.
+//
+// A call site writes one fixed-size LogRecord (the address of its format string plus up to
+// four arguments) into a lock-free ring owned by the calling thread. A background thread
+// collects the records from every thread, formats them and writes them to stdout, so the
+// key-event path never blocks on console I/O.
+//
+// Format strings use "{}" placeholders and must be string literals. String arguments are
+// stored as pointers, so they must outlive the logger (literals, or names owned by objects
+// that live for the whole run such as Mode::getName()).
+//
+// Levels below NK_LOG_LEVEL are compiled out entirely.
+
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_ERROR 3
+#define LOG_LEVEL_OFF 4
+
+#ifndef NK_LOG_LEVEL
+#ifdef _DEBUG
+#define NK_LOG_LEVEL LOG_LEVEL_DEBUG
+#else
+#define NK_LOG_LEVEL LOG_LEVEL_INFO
+#endif
+#endif
+
+#if NK_LOG_LEVEL <= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) Log::write(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) ((void)0)
+#endif
+#if NK_LOG_LEVEL <= LOG_LEVEL_INFO
+#define LOG_INFO(...) Log::write(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) ((void)0)
+#endif
+#if NK_LOG_LEVEL <= LOG_LEVEL_WARN
+#define LOG_WARN(...) Log::write(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...) ((void)0)
+#endif
+#if NK_LOG_LEVEL <= LOG_LEVEL_ERROR
+#define LOG_ERROR(...) Log::write(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) ((void)0)
+#endif
+
+struct LogRecord
+{
+    static constexpr int MAX_ARGS = 4;
+
+    enum ArgType : uint8_t
+    {
+        ARG_INT = 0,
+        ARG_UINT,
+        ARG_DOUBLE,
+        ARG_CHAR,
+        ARG_STRING,
+    };
+
+    union Arg
+    {
+        int64_t i;
+        uint64_t u;
+        double d;
+        const char *s;
+    };
+
+    const char *format; // doubles as the format id
+    uint64_t timestamp; // steady clock, ns
+    uint8_t level;
+    uint8_t argCount;
+    ArgType types[MAX_ARGS];
+    Arg args[MAX_ARGS];
+};
+
+class Log
+{
+public:
+    // Start/stop the background formatter. stop() flushes everything still queued.
+    static void start();
+    static void stop();
+
+    template <typename... Args>
+    static void write(int level, const char *format, const Args &...args)
+    {
+        static_assert(sizeof...(Args) <= LogRecord::MAX_ARGS, "too many log arguments");
+        LogRecord record;
+        record.format = format;
+        record.timestamp = now();
+        record.level = static_cast<uint8_t>(level);
+        record.argCount = 0;
+        int expand[] = {0, (pack(record, args), 0)...};
+        (void)expand;
+        push(record);
+    }
+
+    // A copy of 'text' that lives until exit, for logging strings that would not outlive
+    // the logger (e.g. values read from modes.json). Takes a lock; for startup code only.
+    static const char *intern(const std::string &text);
+
+    // Records dropped because a thread's ring was full or no ring was left for it.
+    static uint64_t droppedCount() { return dropped.load(std::memory_order_relaxed); }
+    // Times the formatter thread woke from its wait; while nothing is logged it stays asleep.
+    static uint64_t wakeupCount() { return wakeups.load(std::memory_order_relaxed); }
+
+    // Turn a record into text; used by the background thread.
+    static void format(const LogRecord &record, std::string &out);
+
+    static constexpr size_t RING_CAPACITY = 1024;
+    static constexpr int MAX_THREADS = 16;
+    typedef EventRing<LogRecord, RING_CAPACITY> Ring;
+
+private:
+    static uint64_t now();
+    static void push(const LogRecord &record);
+
+    static void pack(LogRecord &record, int value) { packArg(record, LogRecord::ARG_INT).i = value; }
+    static void pack(LogRecord &record, long value) { packArg(record, LogRecord::ARG_INT).i = value; }
+    static void pack(LogRecord &record, long long value) { packArg(record, LogRecord::ARG_INT).i = value; }
+    static void pack(LogRecord &record, unsigned char value) { packArg(record, LogRecord::ARG_UINT).u = value; }
+    static void pack(LogRecord &record, unsigned short value) { packArg(record, LogRecord::ARG_UINT).u = value; }
+    static void pack(LogRecord &record, unsigned int value) { packArg(record, LogRecord::ARG_UINT).u = value; }
+    static void pack(LogRecord &record, unsigned long value) { packArg(record, LogRecord::ARG_UINT).u = value; }
+    static void pack(LogRecord &record, unsigned long long value) { packArg(record, LogRecord::ARG_UINT).u = value; }
+    static void pack(LogRecord &record, bool value) { packArg(record, LogRecord::ARG_UINT).u = value ? 1 : 0; }
+    static void pack(LogRecord &record, double value) { packArg(record, LogRecord::ARG_DOUBLE).d = value; }
+    static void pack(LogRecord &record, char value) { packArg(record, LogRecord::ARG_CHAR).i = value; }
+    static void pack(LogRecord &record, const char *value) { packArg(record, LogRecord::ARG_STRING).s = value; }
+
+    static LogRecord::Arg &packArg(LogRecord &record, LogRecord::ArgType type)
+    {
+        record.types[record.argCount] = type;
+        return record.args[record.argCount++];
+    }
+
+    static void formatterThread();
+
+    // Rings are handed out to threads on their first write and never reused.
+    static Ring rings[MAX_THREADS];
+    static std::atomic<int> ringsClaimed;
+    static std::atomic<uint64_t> dropped;
+    static std::atomic<uint64_t> wakeups;
+    static std::atomic<bool> running;
+};
@@ -0,0 +1,183 @@
+#include "Macro.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include "CharToVK.h"
+#include "InjectionBatcher.h"
+
+namespace
+{
+    struct NamedKey
+    {
+        const char *name;
+        int vkCode;
+    };
+
+    const NamedKey NAMED_KEYS[] = {
+        {"enter", VK_RETURN}, {"return", VK_RETURN}, {"tab", VK_TAB}, {"esc", VK_ESCAPE},
+        {"escape", VK_ESCAPE}, {"space", VK_SPACE}, {"backspace", VK_BACK}, {"bksp", VK_BACK},
+        {"delete", VK_DELETE}, {"del", VK_DELETE}, {"insert", VK_INSERT}, {"ins", VK_INSERT},
+        {"home", VK_HOME}, {"end", VK_END}, {"pageup", VK_PRIOR}, {"pgup", VK_PRIOR},
+        {"pagedown", VK_NEXT}, {"pgdn", VK_NEXT}, {"up", VK_UP}, {"down", VK_DOWN},
+        {"left", VK_LEFT}, {"right", VK_RIGHT}, {"capslock", VK_CAPITAL}, {"pause", VK_PAUSE},
+        {"ctrl", VK_CONTROL}, {"control", VK_CONTROL}, {"shift", VK_SHIFT}, {"alt", VK_MENU},
+        {"win", VK_LWIN}, {"plus", VK_OEM_PLUS},
+    };
+
+    // Characters typed with Shift on a US layout, and the key that carries them.
+    const char SHIFTED[] = "!@#$%^&*():+<_>?~{|}\"";
+    const char UNSHIFTED[] = "1234567890;=,-./`[\\]'";
+
+    void tap(std::vector<OutputEvent> &out, int vkCode)
+    {
+        out.push_back(OutputEvent::key(vkCode, true));
+        out.push_back(OutputEvent::key(vkCode, false));
+    }
+
+    // One typed character; returns false if it has no key.
+    bool typeChar(std::vector<OutputEvent> &out, char c)
+    {
+        if (c == '\n')
+        {
+            tap(out, VK_RETURN);
+            return true;
+        }
+        if (c == '\t')
+        {
+            tap(out, VK_TAB);
+            return true;
+        }
+        bool shift = std::isupper(static_cast<unsigned char>(c)) != 0;
+        const char *shifted = std::strchr(SHIFTED, c);
+        if (c != '\0' && shifted != nullptr)
+        {
+            c = UNSHIFTED[shifted - SHIFTED];
+            shift = true;
+        }
+        const int vkCode = CharToVK(c);
+        if (vkCode == 0)
+        {
+            return false;
+        }
+        if (shift)
+            out.push_back(OutputEvent::key(VK_SHIFT, true));
+        tap(out, vkCode);
+        if (shift)
+            out.push_back(OutputEvent::key(VK_SHIFT, false));
+        return true;
+    }
+}
+
+int MacroCompiler::namedKey(const std::string &name)
+{
+    if (name.size() == 1)
+    {
+        return CharToVK(name[0]);
+    }
+    std::string lower(name);
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c)
+                   { return static_cast<char>(std::tolower(c)); });
+    for (const NamedKey &key : NAMED_KEYS)
+    {
+        if (lower == key.name)
+        {
+            return key.vkCode;
+        }
+    }
+    // f1 .. f24
+    if (lower.size() >= 2 && lower[0] == 'f' && std::isdigit(static_cast<unsigned char>(lower[1])))
+    {
+        const int n = std::atoi(lower.c_str() + 1);
+        if (n >= 1 && n <= 24)
+        {
+            return VK_F1 + n - 1;
+        }
+    }
+    return 0;
+}
+
+bool MacroCompiler::compile(const std::string &text, std::vector<OutputEvent> &out, std::string &error)
+{
+    for (size_t i = 0; i < text.size(); i++)
+    {
+        const char c = text[i];
+        if ((c == '{' || c == '}') && i + 1 < text.size() && text[i + 1] == c)
+        {
+            typeChar(out, c);
+            i++;
+            continue;
+        }
+        if (c == '}')
+        {
+            error = "unmatched '}'";
+            return false;
+        }
+        if (c != '{')
+        {
+            if (!typeChar(out, c))
+            {
+                error = std::string("no key for character '") + c + "'";
+                return false;
+            }
+            continue;
+        }
+        const size_t close = text.find('}', i + 1);
+        if (close == std::string::npos)
+        {
+            error = "unterminated '{'";
+            return false;
+        }
+        // A chord: every part but the last is held while the last one is tapped.
+        int chord[8];
+        int parts = 0;
+        size_t start = i + 1;
+        while (start <= close)
+        {
+            size_t end = text.find('+', start);
+            // "{ctrl++}" is Ctrl and the plus key.
+            if (end == start && end + 1 == close)
+                end = close;
+            if (end == std::string::npos || end > close)
+                end = close;
+            const std::string name = text.substr(start, end - start);
+            const int vkCode = namedKey(name);
+            if (vkCode == 0)
+            {
+                error = "unknown key '" + name + "'";
+                return false;
+            }
+            if (parts == 8)
+            {
+                error = "too many keys in a chord";
+                return false;
+            }
+            chord[parts++] = vkCode;
+            start = end + 1;
+        }
+        for (int k = 0; k + 1 < parts; k++)
+            out.push_back(OutputEvent::key(chord[k], true));
+        tap(out, chord[parts - 1]);
+        for (int k = parts - 2; k >= 0; k--)
+            out.push_back(OutputEvent::key(chord[k], false));
+        i = close;
+    }
+    return true;
+}
+
+void MacroTable::set(int vkCode, const std::vector<OutputEvent> &macro)
+{
+    Range &range = ranges[vkCode & 0xFF];
+    range.offset = static_cast<uint32_t>(events.size());
+    range.count = static_cast<uint32_t>(macro.size());
+    events.insert(events.end(), macro.begin(), macro.end());
+}
+
+void MacroTable::play(int vkCode) const
+{
+    const Range &range = ranges[vkCode & 0xFF];
+    if (range.count != 0)
+    {
+        InjectionBatcher::emitAll(events.data() + range.offset, range.count);
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "OutputEvent.h"
+
+// Compiles key_mapping values into the input events they stand for.
+//
+// A value is text, typed as-is ("hello", "Hello!" - shifted characters get a Shift press
+// around them, US layout), with named keys and chords in braces:
+//     {enter} {tab} {esc} {space} {backspace} {delete} {up} {f5} ...
+//     {ctrl+c} {ctrl+shift+t} {alt+f4} {win+d}
+// Modifiers in a chord are pressed in order, the last key is tapped, and the modifiers are
+// released in reverse. "{{" and "}}" type literal braces.
+class MacroCompiler
+{
+public:
+    // Append the events for 'text' to 'out'. On a syntax error returns false and sets 'error'.
+    static bool compile(const std::string &text, std::vector<OutputEvent> &out, std::string &error);
+
+    // VK code for a key name as used in braces ("enter", "f5", "ctrl", or a single character),
+    // or 0 if unknown. Case-insensitive.
+    static int namedKey(const std::string &name);
+};
+
+// Each source key's compiled events, in one flat array that is built while modes load and
+// never changes afterwards. Playing a macro hands its slice to InjectionBatcher in a single
+// call, which copies it into the current batch (or submits it whole if it is longer than a
+// batch).
+class MacroTable
+{
+public:
+    void set(int vkCode, const std::vector<OutputEvent> &events);
+    bool has(int vkCode) const { return ranges[vkCode & 0xFF].count != 0; }
+    size_t length(int vkCode) const { return ranges[vkCode & 0xFF].count; }
+    void play(int vkCode) const;
+
+private:
+    struct Range
+    {
+        uint32_t offset = 0;
+        uint32_t count = 0;
+    };
+
+    std::vector<OutputEvent> events;
+    Range ranges[256];
+};
@@ -1,26 +1,32 @@
 #include "ModeManager.h"
 #include <fstream>
 #include <iostream>
+#include <algorithm>
 #include "KeyState.h"
+#include "OutputKeyTable.h"
 #include "CharToVK.h"
 #include "InputSimulator.h"
 #include "SpaceMode.h"
+#include "Log.h"
 // Define the static activationMap using VK codes as keys.
 std::vector<Mode *> Mode::modes;
-int timeout = 200;
+// A press of the activation key shorter than this is sent on as a normal tap.
+uint64_t timeout = 200 * EventClock::MILLISECOND;
 Mode *Mode::currentMode = nullptr;
+Mode *Mode::activationTable[256] = {};
+KeyRepeater Mode::repeater;
 Mode::Mode(
     const std::string &name,
     const std::unordered_map<int, int> &keyMapping,
     const std::vector<int> &activationKeys)
-    : name(name), keyMapping(keyMapping), activationKeys(activationKeys)
+    : activationKeys(activationKeys), name(name), keyMapping(keyMapping)
 {
     // Register each activation key in the static activationMap,
     // converting each key (if needed) to its corresponding VK code.
     // Since activationKeys are already ints (VK codes), this step might be redundant,
     // but if CharToVK needs to be applied, you can do so.
 }
-bool Mode::handleKeyDownEvent(int keycode)
+bool Mode::handleKeyDownEvent(int keycode, uint64_t timestamp)
 {
     bool handled = false;
     // check if this is the activation key.
@@ -30,56 +36,85 @@ bool Mode::handleKeyDownEvent(int keycode)
     }
     else
     {
-        // Use the unordered_map's find() method.
-        auto mappingIt = keyMapping.find(keycode);
-        bool doSimulateKey = false;
-        if (mappingIt != keyMapping.end())
+        const KeyAction &action = dispatch[keycode];
+        if (action.kind == KeyActionKind::Macro)
         {
-            std::lock_guard<std::mutex> lock(keyStatesMutex);
-            // Ensure the key exists in keyStates; if not, add a default KeyState.
-            if (keyStates.find(keycode) == keyStates.end())
+            if (keyStates.press(keycode, timestamp))
             {
-                keyStates[keycode] = KeyState();
+                LOG_DEBUG("Key down: {} plays a macro of {} events", keycode, macros.length(keycode));
+                macros.play(keycode);
+                // Macros do not repeat, but still stop whatever was repeating.
+                repeater.start(keycode, action, repeatSettings, timestamp);
             }
-            if (keyStates[keycode].held != true)
+            handled = true;
+        }
+        else if (action.kind == KeyActionKind::Remap)
+        {
+            // The remapped key goes down now and up with the source key, so it can be held
+            // and used as a modifier. While held, repeater repeats it.
+            if (keyStates.press(keycode, timestamp))
             {
-                doSimulateKey = true;
-                keyStates[keycode].timePressed = GetTickCount64();
-                keyStates[keycode].held = true;
-                // mappingIt->second is the remapped key (an int)
-                // unlock the mutex
-                std::cout << "Key down: " << keycode << " remapped to " << mappingIt->second << std::endl;
+                LOG_DEBUG("Key down: {} remapped to {}", keycode, action.target);
+                pressedOutputs.press(keycode, action.target);
+                repeater.start(keycode, action, repeatSettings, timestamp);
             }
             handled = true;
         }
-        if (doSimulateKey) {
-            InputSimulator::simulateKeyTap(mappingIt->second);
-        }
     }
     return handled;
 }
 
-bool Mode::handleKeyUpEvent(int keycode)
+bool Mode::handleKeyUpEvent(int keycode, uint64_t timestamp)
 {
     bool handled = false;
-    // Use the unordered_map's find() method to check for a key mapping.
-    auto mappingIt = keyMapping.find(keycode);
-    if (mappingIt != keyMapping.end())
+    const KeyAction &action = dispatch[keycode];
+    if (action.kind == KeyActionKind::Remap || action.kind == KeyActionKind::Macro)
     {
-        std::lock_guard<std::mutex> lock(keyStatesMutex);
-        // Make sure the key exists in keyStates before accessing.a
-        if (keyStates.find(keycode) == keyStates.end())
-        {
-            keyStates[keycode] = KeyState();
-        }
-        keyStates[keycode].timeReleased = GetTickCount64();
-        keyStates[keycode].held = false;
-        std::cout << "Key up: " << keycode << " remapped to " << mappingIt->second << std::endl;
+        keyStates.release(keycode, timestamp);
+        pressedOutputs.release(keycode);
+        repeater.stop(keycode);
+        LOG_DEBUG("Key up: {} remapped to {}", keycode, action.target);
         handled = true;
     }
     return handled;
 }
 
+void Mode::compileDispatch()
+{
+    for (const auto &mapping : keyMapping)
+    {
+        if (mapping.first > 0 && mapping.first < 256)
+        {
+            dispatch[mapping.first] = {KeyActionKind::Remap, static_cast<uint8_t>(mapping.second)};
+        }
+    }
+    for (int vk = 1; vk < 256; vk++)
+    {
+        if (macros.has(vk))
+        {
+            dispatch[vk] = {KeyActionKind::Macro, 0};
+        }
+    }
+}
+
+void Mode::compileDispatchTables()
+{
+    std::fill(std::begin(activationTable), std::end(activationTable), nullptr);
+    for (Mode *mode : modes)
+    {
+        mode->dispatch = KeyDispatchTable();
+        mode->compileDispatch();
+        // Later modes win, matching the order modes were loaded in.
+        for (int vk : mode->activationKeys)
+        {
+            if (vk > 0 && vk < 256)
+            {
+                activationTable[vk] = mode;
+            }
+        }
+    }
+}
+
 const std::string &Mode::getName() const
 {
     return name;
@@ -95,6 +130,39 @@ const std::vector<int> &Mode::getActivationKeys() const
     return activationKeys;
 }
 
+// Optional per-mode repeat settings: "repeat_delay_ms", "repeat_rate_hz" (0 turns repeat
+// off) and "repeat_mouse_buttons".
+KeyRepeater::Settings Mode::loadRepeatSettings(const nlohmann::json &modeEntry)
+{
+    KeyRepeater::Settings settings;
+    const double delayMs = modeEntry.value("repeat_delay_ms", static_cast<double>(settings.delay) / EventClock::MILLISECOND);
+    const double rateHz = modeEntry.value("repeat_rate_hz", static_cast<double>(EventClock::SECOND) / settings.interval);
+    settings.delay = static_cast<uint64_t>(std::max(0.0, delayMs) * EventClock::MILLISECOND);
+    settings.interval = rateHz > 0.0 ? static_cast<uint64_t>(EventClock::SECOND / rateHz) : 0;
+    settings.mouseButtons = modeEntry.value("repeat_mouse_buttons", settings.mouseButtons);
+    return settings;
+}
+
+// Optional per-mode tick rate, "tick_hz"; anything not positive keeps the mode's default.
+void Mode::loadTickRate(const nlohmann::json &modeEntry)
+{
+    const double hz = modeEntry.value("tick_hz", 0.0);
+    if (hz > 0.0)
+    {
+        setTickInterval(static_cast<uint64_t>(EventClock::SECOND / hz));
+    }
+}
+
+uint64_t Mode::shortestTickInterval()
+{
+    uint64_t shortest = UINT64_MAX;
+    for (const Mode *mode : modes)
+    {
+        shortest = std::min(shortest, mode->updateInterval());
+    }
+    return shortest;
+}
+
 std::vector<Mode *> Mode::loadModes(const std::string &filename)
 {
     std::ifstream file(filename);
@@ -104,6 +172,7 @@ std::vector<Mode *> Mode::loadModes(const std::string &filename)
         return modes;
     }
 
+    nlohmann::json mouseEntry = nlohmann::json::object();
     try
     {
         nlohmann::json jsonData;
@@ -116,8 +185,13 @@ std::vector<Mode *> Mode::loadModes(const std::string &filename)
 
         for (const auto &modeEntry : jsonData["modes"])
         {
+            // The built-in mouse mode is not defined here, only tuned.
+            if (modeEntry.value("type", "") == "mouse")
+            {
+                mouseEntry = modeEntry;
+                continue;
+            }
             std::string modeName = modeEntry.value("name", "UnnamedMode");
-            std::cout << "Loading mode " << modeName << std::endl;
 
             // Read and convert activation keys to VK codes.
             std::vector<int> activationKeys;
@@ -128,68 +202,117 @@ std::vector<Mode *> Mode::loadModes(const std::string &filename)
                     std::string keyStr = keyVal.get<std::string>();
                     if (!keyStr.empty())
                     {
-                        std::cout << "found activation key: " << keyStr << " for " << modeName << std::endl;
                         int vk = CharToVK(keyStr[0]);
+                        LOG_DEBUG("Found activation key {} (vk {})", keyStr[0], vk);
                         activationKeys.push_back(vk);
                     }
                 }
             }
 
-            // Read key mapping and convert both keys and mapped values.
+            // Read key mapping. A value that is a single character stays a remap, so the
+            // target key is held and repeats for as long as the source key is; that includes
+            // uppercase letters and shifted symbols, which remap to their unshifted key.
+            // Anything longer (text, {named} keys, {ctrl+c} chords) is compiled into a macro.
             std::unordered_map<int, int> keyMapping;
-            if (modeEntry.contains("key_mapping"))
-                std::cout << "key_mapping: " << modeEntry["key_mapping"] << std::endl;
+            std::unordered_map<int, std::vector<OutputEvent>> macros;
             if (modeEntry.contains("key_mapping"))
             {
-                std::cout << "Found key_mapping for " << modeName << ", about to iterate over it" << std::endl;
                 for (auto it = modeEntry["key_mapping"].begin(); it != modeEntry["key_mapping"].end(); ++it)
                 {
                     std::string src = it.key(); // it.key() already returns a std::string, so no need to call get()
-                    std::cout << "src: " << src << std::endl;
                     std::string dest = it.value().get<std::string>();
-                    std::cout << "dest: " << dest << std::endl;
-                    if (!src.empty() && !dest.empty())
+                    if (src.empty() || dest.empty())
+                    {
+                        continue;
+                    }
+                    int srcVK = MacroCompiler::namedKey(src);
+                    int destVK = dest.size() == 1 ? CharToVK(dest[0]) : 0;
+                    std::vector<OutputEvent> events;
+                    std::string error;
+                    if (srcVK == 0 || (destVK == 0 && !MacroCompiler::compile(dest, events, error)))
                     {
-                        std::cout << "Mapping " << src << " to " << dest << std::endl;
-                        int srcVK = CharToVK(src[0]);
-                        int destVK = CharToVK(dest[0]);
+                        std::cerr << "Mode " << modeName << ": skipping mapping \"" << src << "\": "
+                                  << (srcVK == 0 ? "unknown source key" : error) << std::endl;
+                        continue;
+                    }
+                    if (destVK != 0)
+                    {
+                        LOG_DEBUG("Mapping {} to {} (vk {} -> {})", Log::intern(src), Log::intern(dest), srcVK, destVK);
                         keyMapping[srcVK] = destVK;
                     }
+                    else
+                    {
+                        LOG_DEBUG("Mapping {} (vk {}) to macro {} of {} events", Log::intern(src), srcVK,
+                                  Log::intern(dest), events.size());
+                        macros[srcVK] = std::move(events);
+                    }
                 }
             }
             // Create a new Mode object and add it to our vector.
             Mode *mode = new Mode(modeName, keyMapping, activationKeys);
+            for (const auto &macro : macros)
+            {
+                mode->setMacro(macro.first, macro.second);
+            }
+            mode->setRepeatSettings(loadRepeatSettings(modeEntry));
+            mode->loadTickRate(modeEntry);
             modes.push_back(mode);
+            // The mode owns its name for the rest of the run, so the logger can keep the pointer.
+            LOG_INFO("Loaded mode {} ({} activation keys, {} mappings, {} macros)", mode->getName().c_str(),
+                     activationKeys.size(), keyMapping.size(), macros.size());
         }
     }
     catch (const std::exception &e)
     {
         std::cerr << "Error parsing modes JSON: " << e.what() << std::endl;
     }
-    // add Space mode
-    Mode *spaceMode = new SpaceMode("Mouse Mode", {{VK_SPACE, VK_SPACE}}, {{VK_SPACE}});
+    // add Space mode, with any settings from a {"type": "mouse"} entry: "tick_hz",
+    // "timestep_ms" (the physics step), the "motion" and "scroll" profiles (see
+    // MotionProfile::fromJson) and the repeat settings.
+    SpaceMode *spaceMode = new SpaceMode("Mouse Mode", {{VK_SPACE, VK_SPACE}}, {{VK_SPACE}});
+    MotionProfile cursor, scroll;
+    MotionProfile::preset("classic", MotionProfile::CURSOR, cursor);
+    MotionProfile::preset("classic", MotionProfile::SCROLL, scroll);
+    std::string error;
+    if (mouseEntry.contains("motion") && !MotionProfile::fromJson(mouseEntry["motion"], MotionProfile::CURSOR, cursor, error))
+    {
+        std::cerr << "Mouse mode: ignoring \"motion\": " << error << std::endl;
+    }
+    if (mouseEntry.contains("scroll") && !MotionProfile::fromJson(mouseEntry["scroll"], MotionProfile::SCROLL, scroll, error))
+    {
+        std::cerr << "Mouse mode: ignoring \"scroll\": " << error << std::endl;
+    }
+    spaceMode->setProfiles(cursor, scroll);
+    spaceMode->setRepeatSettings(loadRepeatSettings(mouseEntry));
+    spaceMode->loadTickRate(mouseEntry);
+    const double timestepMs = mouseEntry.value("timestep_ms", 0.0);
+    if (timestepMs > 0.0)
+    {
+        spaceMode->setTimestep(static_cast<uint64_t>(timestepMs * EventClock::MILLISECOND));
+    }
+    LOG_INFO("Mouse mode ticks every {} us, physics step {} us", spaceMode->updateInterval() / EventClock::MICROSECOND,
+             spaceMode->timestepLength() / EventClock::MICROSECOND);
     modes.push_back(spaceMode);
+    compileDispatchTables();
     return modes;
 }
 
 // return this as a pointer to the current mode.
 
-bool Mode::checkActiveModeEnded(int vkCode)
+bool Mode::checkActiveModeEnded(int vkCode, uint64_t timestamp)
 {
     bool handled = false;
-    Mode *currentMode = nullptr;
     if (Mode::currentMode != nullptr)
     {
         if (vkCode == Mode::currentMode->keyCodeActivatedBy)
         {
             // check for timeout
-            DWORD now = GetTickCount64();
-            DWORD heldTime = now - keyStates[vkCode].timePressed;
+            uint64_t heldTime = timestamp - keyStates.timePressed(vkCode);
             if (heldTime < timeout)
             {
                 InputSimulator::simulateKeyTap(vkCode);
             }
-            Mode::currentMode = nullptr;
+            endCurrentMode();
             handled = true;
         }
     }
@@ -202,18 +325,24 @@ bool Mode::checkIfActivatesMode(int vkCode)
     bool handled = false;
     if (Mode::currentMode == nullptr)
     {
-        for (Mode *mode : Mode::modes)
+        Mode *mode = activationTable[vkCode & 0xFF];
+        if (mode != nullptr)
         {
-            auto it = std::find(mode->activationKeys.begin(), mode->activationKeys.end(), vkCode);
-            if (it != mode->activationKeys.end())
-            {
-                Mode::currentMode = mode;
-                Mode::currentMode->keyCodeActivatedBy = vkCode;
-                handled = true;
-            }
+            Mode::currentMode = mode;
+            Mode::currentMode->keyCodeActivatedBy = vkCode;
+            handled = true;
         }
     }
 
     return handled;
 }
+void Mode::endCurrentMode()
+{
+    // Nothing we pressed for the mode may stay down (or keep repeating) once it is gone.
+    repeater.stopAll();
+    pressedOutputs.releaseAll();
+    Mode::currentMode = nullptr;
+}
+
 void Mode::Update() {}
+
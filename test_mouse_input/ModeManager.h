@@ -1,10 +1,14 @@
 #pragma once
 
+#include <atomic>
 #include <unordered_map>
 #include <vector>
 #include <string>
 #include "nlohmann/json.hpp" // Make sure the include path is correct
 #include "KeyState.h"
+#include "DispatchTable.h"
+#include "Macro.h"
+#include "KeyRepeater.h"
 
 // The Mode class encapsulates a mode that remaps keys.
 // For example, a mode might map "ASDFGHJKL;" to "1234567890".
@@ -23,10 +27,21 @@ public:
     const std::string &getName() const;
     const std::unordered_map<int, int> &getKeyMapping() const;
     const std::vector<int> &getActivationKeys() const;
+    // Key repeat for this mode's remapped (and optionally mouse-button) keys.
+    void setRepeatSettings(const KeyRepeater::Settings &settings) { repeatSettings = settings; }
+    // The one repeat generator; see KeyRepeater. Engine thread.
+    static KeyRepeater repeater;
+
+    // Key mappings whose value is more than one plain key; see MacroCompiler.
+    void setMacro(int vkCode, const std::vector<OutputEvent> &events) { macros.set(vkCode, events); }
 
     // Static method to load modes from a JSON file.
     // Returns a vector of pointers to Mode objects.
     static std::vector<Mode *> loadModes(const std::string &filename);
+    static KeyRepeater::Settings loadRepeatSettings(const nlohmann::json &modeEntry);
+    void loadTickRate(const nlohmann::json &modeEntry);
+    // The shortest updateInterval() of the loaded modes, or UINT64_MAX if there are none.
+    static uint64_t shortestTickInterval();
 
     // A static dictionary mapping each activation key to a Mode pointer.
     // If a mode has more than one activation key, each is a key in this dictionary.
@@ -38,13 +53,42 @@ public:
     // Returns a pointer to the active Mode, or nullptr if none.
     // In Mode.h, add the declaration:
     static bool checkIfActivatesMode(int vkCode);
-    static bool checkActiveModeEnded(int vkCode);
-    virtual bool handleKeyUpEvent(int keycode);
-    virtual bool handleKeyDownEvent(int keycode);
+    // 'timestamp' is the event's own EventClock time, as reconciled by the hook.
+    static bool checkActiveModeEnded(int vkCode, uint64_t timestamp);
+    // Leave the current mode, releasing every output key it is still holding.
+    static void endCurrentMode();
+    virtual bool handleKeyUpEvent(int keycode, uint64_t timestamp);
+    virtual bool handleKeyDownEvent(int keycode, uint64_t timestamp);
+
+    // Fill 'dispatch' from this mode's configuration. Called once per mode by
+    // compileDispatchTables(), after all modes are loaded.
+    virtual void compileDispatch();
+    // Rebuild activationTable and every mode's dispatch table.
+    static void compileDispatchTables();
+    // What this mode does with vkCode while it is active: a single indexed load.
+    const KeyAction &actionFor(int vkCode) const { return dispatch[vkCode]; }
+    // activationTable[vk] is the mode that vk activates, or nullptr.
+    alignas(64) static Mode *activationTable[256];
+    // Set by the hook watchdog when this mode is pushing the hook towards its timeout.
+    // A degraded mode gets a pure passthrough verdict until the watchdog restores it.
+    std::atomic<bool> degraded{false};
     int keyCodeActivatedBy;
     static Mode *currentMode;
     std::vector<int> activationKeys;
     virtual void Update();
+    // How long the polling thread waits after Update() before calling it again, in ns
+    // ("tick_hz" in modes.json).
+    virtual uint64_t updateInterval() const { return tickInterval; }
+    void setTickInterval(uint64_t interval) { tickInterval = interval; }
+    // Asked after each Update(): is anything still moving? If not, the polling thread
+    // sleeps until a key whose action needsTicks() is pressed. Polling thread only.
+    virtual bool needsTicks() const { return false; }
+
+protected:
+    KeyDispatchTable dispatch;
+    MacroTable macros;
+    KeyRepeater::Settings repeatSettings;
+    uint64_t tickInterval = 10 * EventClock::MILLISECOND;
 
 private:
     std::string name;
@@ -0,0 +1,245 @@
+#include "MotionCurve.h"
+#include <algorithm>
+#include <cmath>
+
+void MotionCurve::constant(double value)
+{
+    sample(1.0, [value](double)
+           { return value; });
+}
+
+bool MotionCurve::piecewise(const std::vector<std::pair<double, double>> &points, std::string &error)
+{
+    if (points.size() < 2)
+    {
+        error = "a curve needs at least two points";
+        return false;
+    }
+    if (points.front().first != 0.0)
+    {
+        error = "a curve must start at time 0";
+        return false;
+    }
+    for (size_t i = 1; i < points.size(); i++)
+    {
+        if (!(points[i].first > points[i - 1].first))
+        {
+            error = "curve times must increase";
+            return false;
+        }
+    }
+    size_t segment = 0;
+    sample(points.back().first, [&](double t)
+           {
+               while (segment + 2 < points.size() && t > points[segment + 1].first)
+               {
+                   segment++;
+               }
+               const std::pair<double, double> &a = points[segment];
+               const std::pair<double, double> &b = points[segment + 1];
+               const double f = std::min(1.0, (t - a.first) / (b.first - a.first));
+               return a.second + (b.second - a.second) * f; });
+    return true;
+}
+
+bool MotionCurve::bezier(double x1, double y1, double x2, double y2, double seconds, double from, double to, std::string &error)
+{
+    if (x1 < 0.0 || x1 > 1.0 || x2 < 0.0 || x2 > 1.0)
+    {
+        error = "bezier x control points must be between 0 and 1";
+        return false;
+    }
+    if (!(seconds > 0.0))
+    {
+        error = "bezier duration must be positive";
+        return false;
+    }
+    // x(s) is monotonic for x1, x2 in [0, 1], so bisection finds s for each sample's x.
+    auto cubic = [](double p1, double p2, double s)
+    {
+        const double r = 1.0 - s;
+        return 3.0 * r * r * s * p1 + 3.0 * r * s * s * p2 + s * s * s;
+    };
+    sample(seconds, [&](double t)
+           {
+               const double x = t / seconds;
+               double lo = 0.0, hi = 1.0;
+               for (int i = 0; i < 40; i++)
+               {
+                   const double mid = (lo + hi) / 2.0;
+                   (cubic(x1, x2, mid) < x ? lo : hi) = mid;
+               }
+               return from + (to - from) * cubic(y1, y2, (lo + hi) / 2.0); });
+    return true;
+}
+
+namespace
+{
+    // The original tuning was per 60 ms tick; see SpaceMode.
+    constexpr double TUNED_TICK = 0.060;
+
+    // An exponential glide keeping 'perTick' of the speed each tuned tick, until it is
+    // negligible.
+    void exponentialGlide(MotionCurve &curve, double perTick, double seconds)
+    {
+        const double rate = std::log(perTick) / TUNED_TICK;
+        curve.sample(seconds, [rate](double t)
+                     { return std::exp(rate * t); });
+    }
+
+    void linearRamp(MotionCurve &curve, double seconds, double top)
+    {
+        std::string unused;
+        curve.piecewise({{0.0, 0.0}, {seconds, top}}, unused);
+    }
+}
+
+bool MotionProfile::preset(const std::string &name, Target target, MotionProfile &out)
+{
+    // Scrolling runs in WHEEL_DELTA units, about five times the cursor's pixel figures.
+    const double units = target == SCROLL ? 4.8 : 1.0;
+    std::string unused;
+    out = MotionProfile();
+    if (name == "classic")
+    {
+        // +2 px (12 wheel units) per tick each tick up to 50 px (240), then 15% (30%) of
+        // the speed lost per tick: the motion SpaceMode always had.
+        if (target == CURSOR)
+        {
+            linearRamp(out.speed, 1.5, 50.0 / TUNED_TICK);
+            exponentialGlide(out.glide, 0.85, 2.0);
+            out.stopSpeed = 0.1 / TUNED_TICK;
+        }
+        else
+        {
+            linearRamp(out.speed, 1.2, 240.0 / TUNED_TICK);
+            exponentialGlide(out.glide, 0.7, 1.0);
+            out.stopSpeed = 1.2 / TUNED_TICK;
+        }
+        return true;
+    }
+    if (name == "precise")
+    {
+        // Slow to start and slow at the top, with almost no glide: for small targets.
+        out.speed.piecewise({{0.0, 0.0}, {0.4, 150.0 * units}, {1.5, 400.0 * units}}, unused);
+        out.glide.piecewise({{0.0, 1.0}, {0.12, 0.0}}, unused);
+        out.bothKeys = 2.0;
+        out.stopSpeed = 1.0 * units;
+        return true;
+    }
+    if (name == "fast")
+    {
+        // Quick to full speed and much faster at the top: for crossing large screens.
+        out.speed.piecewise({{0.0, 0.0}, {0.3, 800.0 * units}, {0.8, 2400.0 * units}}, unused);
+        exponentialGlide(out.glide, 0.8, 1.5);
+        out.stopSpeed = 2.0 * units;
+        return true;
+    }
+    if (name == "smooth")
+    {
+        // Eases in and out of top speed, and eases to a stop.
+        out.speed.bezier(0.42, 0.0, 0.58, 1.0, 1.2, 0.0, 1000.0 * units, unused);
+        out.glide.bezier(0.25, 0.1, 0.25, 1.0, 0.6, 1.0, 0.0, unused);
+        out.stopSpeed = 1.0 * units;
+        return true;
+    }
+    return false;
+}
+
+namespace
+{
+    bool curveFromJson(const nlohmann::json &spec, MotionProfile::Target target, bool glide, MotionCurve &out, std::string &error)
+    {
+        if (spec.is_string())
+        {
+            MotionProfile named;
+            if (!MotionProfile::preset(spec.get<std::string>(), target, named))
+            {
+                error = "unknown preset \"" + spec.get<std::string>() + "\"";
+                return false;
+            }
+            out = glide ? named.glide : named.speed;
+            return true;
+        }
+        if (spec.contains("points"))
+        {
+            std::vector<std::pair<double, double>> points;
+            for (const auto &point : spec["points"])
+            {
+                if (!point.is_array() || point.size() != 2)
+                {
+                    error = "curve points must be [time, value] pairs";
+                    return false;
+                }
+                points.emplace_back(point[0].get<double>(), point[1].get<double>());
+            }
+            return out.piecewise(points, error);
+        }
+        if (spec.contains("bezier"))
+        {
+            const nlohmann::json &control = spec["bezier"];
+            if (!control.is_array() || control.size() != 4)
+            {
+                error = "\"bezier\" must be [x1, y1, x2, y2]";
+                return false;
+            }
+            if (!glide && !spec.contains("to"))
+            {
+                error = "a bezier speed curve needs \"to\" (its top speed)";
+                return false;
+            }
+            return out.bezier(control[0].get<double>(), control[1].get<double>(), control[2].get<double>(),
+                              control[3].get<double>(), spec.value("duration", 1.0),
+                              spec.value("from", glide ? 1.0 : 0.0), spec.value("to", 0.0), error);
+        }
+        error = "a curve is a preset name, {\"points\": ...} or {\"bezier\": ...}";
+        return false;
+    }
+}
+
+bool MotionProfile::fromJson(const nlohmann::json &spec, Target target, MotionProfile &out, std::string &error)
+{
+    try
+    {
+        if (spec.is_string())
+        {
+            if (!preset(spec.get<std::string>(), target, out))
+            {
+                error = "unknown preset \"" + spec.get<std::string>() + "\"";
+                return false;
+            }
+            return true;
+        }
+        if (!spec.is_object())
+        {
+            error = "expected a preset name or an object";
+            return false;
+        }
+        MotionProfile profile;
+        const std::string base = spec.value("preset", "classic");
+        if (!preset(base, target, profile))
+        {
+            error = "unknown preset \"" + base + "\"";
+            return false;
+        }
+        if (spec.contains("speed") && !curveFromJson(spec["speed"], target, false, profile.speed, error))
+        {
+            error = "speed: " + error;
+            return false;
+        }
+        if (spec.contains("glide") && !curveFromJson(spec["glide"], target, true, profile.glide, error))
+        {
+            error = "glide: " + error;
+            return false;
+        }
+        profile.bothKeys = spec.value("both_keys", profile.bothKeys);
+        profile.stopSpeed = spec.value("stop_speed", profile.stopSpeed);
+        out = profile;
+        return true;
+    }
+    catch (const std::exception &e)
+    {
+        error = e.what();
+        return false;
+    }
+}
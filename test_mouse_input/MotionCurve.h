@@ -0,0 +1,88 @@
+#pragma once
+#include <string>
+#include <utility>
+#include <vector>
+#include "nlohmann/json.hpp"
+
+// A function of time (seconds) compiled into a fixed-size table. evaluate() is an index
+// computation and one linear interpolation, so the physics step never calls pow() or
+// exp(); past the end of the curve it holds the last value.
+class MotionCurve
+{
+public:
+    static constexpr int TABLE_SIZE = 256;
+
+    // A flat curve at 'value'.
+    explicit MotionCurve(double value = 0.0) { constant(value); }
+
+    double evaluate(double t) const
+    {
+        if (t <= 0.0)
+        {
+            return table[0];
+        }
+        const double x = t * scale;
+        if (x >= TABLE_SIZE)
+        {
+            return table[TABLE_SIZE];
+        }
+        const int i = static_cast<int>(x);
+        const double f = x - i;
+        return table[i] + (table[i + 1] - table[i]) * f;
+    }
+
+    double duration() const { return length; }
+
+    void constant(double value);
+    // Piecewise linear through (time, value) points, in increasing time.
+    bool piecewise(const std::vector<std::pair<double, double>> &points, std::string &error);
+    // CSS-style cubic Bezier easing from (0, 0) to (1, 1) with control points (x1, y1) and
+    // (x2, y2), stretched over 'seconds' and mapped onto 'from'..'to'.
+    bool bezier(double x1, double y1, double x2, double y2, double seconds, double from, double to, std::string &error);
+    // Sample any function over 0..seconds (used by the presets).
+    template <typename F>
+    void sample(double seconds, F f)
+    {
+        length = seconds;
+        scale = TABLE_SIZE / seconds;
+        for (int i = 0; i <= TABLE_SIZE; i++)
+        {
+            table[i] = f(seconds * i / TABLE_SIZE);
+        }
+    }
+
+private:
+    double table[TABLE_SIZE + 1];
+    double length = 1.0;
+    double scale = TABLE_SIZE;
+};
+
+// How one SpaceMode axis (cursor or scroll) responds to its keys.
+//
+// While a key is held, speed follows 'speed' by hold time; holding both keys of a direction
+// runs along the curve 'bothKeys' times faster. Once released, the axis glides at its
+// release speed times 'glide' (1 at release, falling towards 0) by time since release,
+// and stops below 'stopSpeed'. Speeds are pixels per second for the cursor and
+// WHEEL_DELTA units per second for scrolling.
+struct MotionProfile
+{
+    MotionCurve speed;
+    MotionCurve glide{1.0};
+    double bothKeys = 3.0;
+    double stopSpeed = 0.0;
+
+    enum Target
+    {
+        CURSOR,
+        SCROLL,
+    };
+
+    // Named presets: "classic" (the original feel), "precise", "fast" and "smooth".
+    static bool preset(const std::string &name, Target target, MotionProfile &out);
+
+    // From a modes.json value: a preset name, or an object with an optional "preset" to
+    // start from and any of "speed", "glide" (each a preset name, {"points": [[t, v], ...]}
+    // or {"bezier": [x1, y1, x2, y2], "duration": s, "from": v0, "to": v1}), "both_keys"
+    // and "stop_speed". On error returns false and sets 'error'.
+    static bool fromJson(const nlohmann::json &spec, Target target, MotionProfile &out, std::string &error);
+};
@@ -0,0 +1,146 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include "EventClock.h"
+#include "MotionCurve.h"
+#include "SubpixelAccumulator.h"
+
+// Splits real elapsed time into whole fixed-length physics steps. Each call to advance()
+// adds the time since the previous call and returns how many steps are now due; the rest
+// is kept for next time. Motion integrated this way depends only on how long keys were
+// held, not on how often, or how punctually, the caller runs.
+class FixedTimestep
+{
+public:
+    static constexpr uint64_t DEFAULT_STEP = EventClock::MILLISECOND;
+    // A gap longer than this (the mode was just entered, or the thread was stalled) is
+    // dropped rather than replayed as a burst of motion.
+    static constexpr uint64_t MAX_GAP = 250 * EventClock::MILLISECOND;
+
+    explicit FixedTimestep(uint64_t step = DEFAULT_STEP) : stepLength(step) {}
+
+    void setStep(uint64_t step)
+    {
+        stepLength = std::max<uint64_t>(step, 1);
+        pending = 0;
+    }
+    uint64_t step() const { return stepLength; }
+    double stepSeconds() const { return static_cast<double>(stepLength) / EventClock::SECOND; }
+
+    // Number of whole steps covered by the time since the last call.
+    uint32_t advance(uint64_t now)
+    {
+        const uint64_t gap = now - last;
+        last = now;
+        if (!started || gap > MAX_GAP)
+        {
+            started = true;
+            pending = 0;
+            return 0;
+        }
+        pending += gap;
+        const uint64_t steps = pending / stepLength;
+        pending -= steps * stepLength;
+        return static_cast<uint32_t>(steps);
+    }
+
+    // Forget the elapsed time; the next advance() starts afresh.
+    void restart()
+    {
+        started = false;
+        pending = 0;
+    }
+
+private:
+    uint64_t stepLength;
+    uint64_t last = 0;
+    uint64_t pending = 0;
+    bool started = false;
+};
+
+// One axis of key-driven motion (cursor or scroll), integrated one fixed step at a time
+// along the curves of a MotionProfile: the speed curve by hold time while pushed, the
+// glide curve by time since release afterwards. The position goes into a
+// SubpixelAccumulator so the caller can take whole units whenever it outputs.
+class MotionAxisIntegrator
+{
+public:
+    // 'profile' must outlive the integrator.
+    void configure(const MotionProfile *newProfile, double stepSeconds)
+    {
+        profile = newProfile;
+        dt = stepSeconds;
+    }
+
+    // Advance by one step. 'thrust' is the net push (held keys, signed): its sign is the
+    // direction and its size how fast the axis moves along the speed curve.
+    void step(double thrust)
+    {
+        if (thrust != 0.0)
+        {
+            // Pushing the other way starts the curve again from the bottom.
+            if (!pushed || (thrust > 0.0) != pushedForward)
+            {
+                holdTime = 0.0;
+                pushed = true;
+                pushedForward = thrust > 0.0;
+            }
+            holdTime += std::abs(thrust) * dt;
+            const double speed = profile->speed.evaluate(holdTime);
+            velocity = thrust > 0.0 ? speed : -speed;
+        }
+        else
+        {
+            if (pushed)
+            {
+                pushed = false;
+                releaseVelocity = velocity;
+                releaseTime = 0.0;
+            }
+            if (velocity == 0.0)
+            {
+                return;
+            }
+            releaseTime += dt;
+            velocity = releaseVelocity * profile->glide.evaluate(releaseTime);
+            if (std::abs(velocity) < profile->stopSpeed)
+            {
+                stop();
+                return;
+            }
+        }
+        travelled += position.add(velocity * dt);
+    }
+
+    // Whole units travelled since the last call; fractions carry over.
+    int take()
+    {
+        const int whole = travelled;
+        travelled = 0;
+        return whole;
+    }
+
+    // Stop dead and drop the fraction not yet travelled (e.g. against the edge of the screen).
+    void stop()
+    {
+        velocity = 0.0;
+        pushed = false;
+        position.reset();
+    }
+
+    double speed() const { return velocity; }
+    bool moving() const { return velocity != 0.0; }
+
+private:
+    const MotionProfile *profile = nullptr;
+    double dt = 0.0;
+    double velocity = 0.0;
+    bool pushed = false;
+    bool pushedForward = false;
+    double holdTime = 0.0;    // seconds along the speed curve
+    double releaseTime = 0.0; // seconds along the glide curve
+    double releaseVelocity = 0.0;
+    SubpixelAccumulator position;
+    int travelled = 0; // whole units not yet taken
+};
@@ -0,0 +1,101 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// A bounded multi-producer/single-consumer queue (Vyukov's array queue).
+// Every slot carries a sequence number: a producer claims a position with one CAS on the
+// enqueue counter, fills the slot in place and publishes it by bumping the slot's
+// sequence; the consumer takes slots strictly in position order. Items from any one
+// producer therefore come out in the order that producer pushed them. Never allocates;
+// tryPush() fails instead of waiting when the queue is full.
+template <typename T, size_t Capacity>
+class MpscQueue
+{
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "MpscQueue capacity must be a power of two");
+
+public:
+    MpscQueue()
+    {
+        for (size_t i = 0; i < Capacity; i++)
+        {
+            slots_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    // Producer side. 'fill(T &)' writes the item straight into its slot.
+    template <typename Fill>
+    bool tryPush(Fill fill)
+    {
+        size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+        Slot *slot;
+        for (;;)
+        {
+            slot = &slots_[pos & (Capacity - 1)];
+            const size_t sequence = slot->sequence.load(std::memory_order_acquire);
+            const intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+            if (diff == 0)
+            {
+                if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false; // full
+            }
+            else
+            {
+                pos = enqueuePos_.load(std::memory_order_relaxed);
+            }
+        }
+        fill(slot->value);
+        slot->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side. 'use(T &)' sees the item in place, before the slot is recycled.
+    template <typename Use>
+    bool tryPop(Use use)
+    {
+        const size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+        Slot &slot = slots_[pos & (Capacity - 1)];
+        if (slot.sequence.load(std::memory_order_acquire) != pos + 1)
+        {
+            return false;
+        }
+        use(slot.value);
+        slot.sequence.store(pos + Capacity, std::memory_order_release);
+        dequeuePos_.store(pos + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // True if the consumer has nothing ready right now.
+    bool empty() const
+    {
+        const size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+        return slots_[pos & (Capacity - 1)].sequence.load(std::memory_order_acquire) != pos + 1;
+    }
+
+    // Approximate number of claimed but not yet consumed slots.
+    size_t size() const
+    {
+        const size_t head = enqueuePos_.load(std::memory_order_relaxed);
+        const size_t tail = dequeuePos_.load(std::memory_order_relaxed);
+        return head > tail ? head - tail : 0;
+    }
+
+    static constexpr size_t capacity() { return Capacity; }
+
+private:
+    struct Slot
+    {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    Slot slots_[Capacity];
+    alignas(64) std::atomic<size_t> enqueuePos_{0};
+    alignas(64) std::atomic<size_t> dequeuePos_{0};
+};
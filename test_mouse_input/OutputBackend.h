@@ -0,0 +1,23 @@
+#pragma once
+#include <cstddef>
+#include "OutputEvent.h"
+
+// Where synthetic input finally goes: key down/up, relative and absolute motion, mouse
+// buttons and wheel, all as OutputEvents. submit() receives a whole batch, in order, and
+// should hand it to the OS in as few calls as possible (SendInputBackend on Windows,
+// UinputBackend on Linux).
+class OutputBackend
+{
+public:
+    virtual ~OutputBackend() {}
+    virtual void submit(const OutputEvent *events, size_t count) = 0;
+
+    // Where the pointer is now, in virtual-desktop pixels. Backends that cannot ask the
+    // system track it from what they have sent. Returns false if unknown.
+    virtual bool cursorPosition(int &x, int &y)
+    {
+        (void)x;
+        (void)y;
+        return false;
+    }
+};
@@ -0,0 +1,76 @@
+#pragma once
+#include <cstdint>
+
+enum MouseButton : uint8_t
+{
+    MOUSE_LEFT = 0,
+    MOUSE_RIGHT,
+    MOUSE_MIDDLE,
+};
+
+enum class OutputKind : uint8_t
+{
+    KeyDown = 0,
+    KeyUp,
+    MouseMove,   // relative, dx/dy in pixels
+    MouseMoveTo, // absolute, dx/dy in virtual-desktop pixels
+    ButtonDown,  // button is a MouseButton
+    ButtonUp,
+    Wheel,       // dy vertical (positive = away from the user), dx horizontal (positive = right),
+                 // both in WHEEL_DELTA units: 120 is one notch, smaller values are hi-res scrolling
+};
+
+// One synthetic input event, independent of the OS API that will eventually send it.
+// InputSimulator produces these, InjectionBatcher collects them and an OutputBackend
+// turns a batch into SendInput (or whatever the platform uses) in one call.
+struct OutputEvent
+{
+    OutputKind kind = OutputKind::KeyDown;
+    uint8_t button = 0;
+    uint16_t vkCode = 0;
+    int32_t dx = 0;
+    int32_t dy = 0;
+
+    static OutputEvent key(int vkCode, bool down)
+    {
+        OutputEvent event;
+        event.kind = down ? OutputKind::KeyDown : OutputKind::KeyUp;
+        event.vkCode = static_cast<uint16_t>(vkCode);
+        return event;
+    }
+
+    static OutputEvent move(int dx, int dy)
+    {
+        OutputEvent event;
+        event.kind = OutputKind::MouseMove;
+        event.dx = dx;
+        event.dy = dy;
+        return event;
+    }
+
+    static OutputEvent moveTo(int x, int y)
+    {
+        OutputEvent event;
+        event.kind = OutputKind::MouseMoveTo;
+        event.dx = x;
+        event.dy = y;
+        return event;
+    }
+
+    static OutputEvent wheel(int dx, int dy)
+    {
+        OutputEvent event;
+        event.kind = OutputKind::Wheel;
+        event.dx = dx;
+        event.dy = dy;
+        return event;
+    }
+
+    static OutputEvent mouseButton(MouseButton button, bool down)
+    {
+        OutputEvent event;
+        event.kind = down ? OutputKind::ButtonDown : OutputKind::ButtonUp;
+        event.button = button;
+        return event;
+    }
+};
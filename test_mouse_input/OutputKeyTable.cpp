@@ -0,0 +1,39 @@
+#include "OutputKeyTable.h"
+#include "InputSimulator.h"
+
+OutputKeyTable pressedOutputs;
+
+void OutputKeyTable::press(int source, int output)
+{
+    // A source should not already hold something, but if it does, let go of that first.
+    release(source);
+    holders[output & 0xFF].fetch_add(1, std::memory_order_acq_rel);
+    heldBy[source & 0xFF].store(static_cast<uint8_t>(output), std::memory_order_release);
+    // Sent even if another source already holds it: that is what a held key's repeat looks like.
+    InputSimulator::keyDown(output);
+}
+
+bool OutputKeyTable::release(int source)
+{
+    const int output = heldBy[source & 0xFF].exchange(0, std::memory_order_acq_rel);
+    if (output == 0)
+    {
+        return false;
+    }
+    if (holders[output].fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        InputSimulator::keyUp(output);
+    }
+    return true;
+}
+
+void OutputKeyTable::releaseAll()
+{
+    for (int source = 1; source < KEY_COUNT; source++)
+    {
+        if (heldBy[source].load(std::memory_order_relaxed) != 0)
+        {
+            release(source);
+        }
+    }
+}
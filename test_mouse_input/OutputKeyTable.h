@@ -0,0 +1,35 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+// Which output keys we are holding down on the user's behalf.
+//
+// A remapped key forwards its press and release separately, so between the two the OS
+// sees the output key held. This table remembers, per source key, which output key it is
+// holding, and per output key how many sources hold it (two sources mapped to the same
+// output release it only when both are up). The mode can end from more than one place, so
+// every update is a single atomic exchange or add on fixed arrays: whichever thread takes
+// a source's slot is the one that sends its key-up, and nothing is released twice.
+class OutputKeyTable
+{
+public:
+    static constexpr int KEY_COUNT = 256;
+
+    // 'source' is now holding 'output' down. Sends the output's key-down.
+    void press(int source, int output);
+    // 'source' was released. Sends the key-up of its output once no other source holds it.
+    // Returns false if the source was not holding anything.
+    bool release(int source);
+    // Release everything, e.g. when the mode that pressed the keys ends.
+    void releaseAll();
+
+    // The output key 'source' is holding, or 0.
+    int outputFor(int source) const { return heldBy[source & 0xFF].load(std::memory_order_acquire); }
+    bool isPressed(int output) const { return holders[output & 0xFF].load(std::memory_order_acquire) != 0; }
+
+private:
+    std::atomic<uint8_t> heldBy[KEY_COUNT] = {};
+    std::atomic<uint8_t> holders[KEY_COUNT] = {};
+};
+
+extern OutputKeyTable pressedOutputs;
@@ -0,0 +1,236 @@
+#include "RecordingBackend.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include "EventClock.h"
+
+namespace
+{
+    const char *kindName(OutputKind kind)
+    {
+        switch (kind)
+        {
+        case OutputKind::KeyDown:
+            return "key_down";
+        case OutputKind::KeyUp:
+            return "key_up";
+        case OutputKind::MouseMove:
+            return "move";
+        case OutputKind::MouseMoveTo:
+            return "move_to";
+        case OutputKind::ButtonDown:
+            return "button_down";
+        case OutputKind::ButtonUp:
+            return "button_up";
+        case OutputKind::Wheel:
+            return "wheel";
+        }
+        return "unknown";
+    }
+
+    bool kindFromName(const std::string &name, OutputKind &kind)
+    {
+        static const OutputKind kinds[] = {OutputKind::KeyDown, OutputKind::KeyUp, OutputKind::MouseMove,
+                                           OutputKind::MouseMoveTo, OutputKind::ButtonDown, OutputKind::ButtonUp,
+                                           OutputKind::Wheel};
+        for (OutputKind candidate : kinds)
+        {
+            if (name == kindName(candidate))
+            {
+                kind = candidate;
+                return true;
+            }
+        }
+        return false;
+    }
+}
+
+RecordingBackend::RecordingBackend(size_t capacity)
+    : events(capacity)
+{
+}
+
+void RecordingBackend::submit(const OutputEvent *batch, size_t batchCount)
+{
+    const uint64_t now = EventClock::now();
+    submits++;
+    for (size_t i = 0; i < batchCount; i++)
+    {
+        const OutputEvent &event = batch[i];
+        if (event.kind == OutputKind::MouseMove)
+        {
+            cursorX = std::min(std::max(cursorX + event.dx, 0), width - 1);
+            cursorY = std::min(std::max(cursorY + event.dy, 0), height - 1);
+        }
+        else if (event.kind == OutputKind::MouseMoveTo)
+        {
+            cursorX = event.dx;
+            cursorY = event.dy;
+        }
+        if (count == events.size())
+        {
+            overflows++;
+            continue;
+        }
+        events[count].timestamp = now;
+        events[count].event = event;
+        count++;
+    }
+}
+
+bool RecordingBackend::cursorPosition(int &x, int &y)
+{
+    x = cursorX;
+    y = cursorY;
+    return true;
+}
+
+void RecordingBackend::setDesktop(int desktopWidth, int desktopHeight)
+{
+    width = desktopWidth;
+    height = desktopHeight;
+    cursorX = width / 2;
+    cursorY = height / 2;
+}
+
+void RecordingBackend::clear()
+{
+    count = 0;
+    submits = 0;
+    overflows = 0;
+    cursorX = width / 2;
+    cursorY = height / 2;
+}
+
+void RecordingBackend::write(std::ostream &out, const RecordedEvent &recorded)
+{
+    const OutputEvent &event = recorded.event;
+    out << recorded.timestamp << ' ' << kindName(event.kind);
+    switch (event.kind)
+    {
+    case OutputKind::KeyDown:
+    case OutputKind::KeyUp:
+        out << ' ' << event.vkCode;
+        break;
+    case OutputKind::ButtonDown:
+    case OutputKind::ButtonUp:
+        out << ' ' << static_cast<int>(event.button);
+        break;
+    default:
+        out << ' ' << event.dx << ' ' << event.dy;
+        break;
+    }
+}
+
+bool RecordingBackend::parse(const std::string &line, RecordedEvent &out)
+{
+    std::istringstream in(line);
+    std::string name;
+    if (!(in >> out.timestamp >> name))
+    {
+        return false;
+    }
+    out.event = OutputEvent();
+    if (!kindFromName(name, out.event.kind))
+    {
+        return false;
+    }
+    int a = 0, b = 0;
+    switch (out.event.kind)
+    {
+    case OutputKind::KeyDown:
+    case OutputKind::KeyUp:
+        if (!(in >> a))
+            return false;
+        out.event.vkCode = static_cast<uint16_t>(a);
+        break;
+    case OutputKind::ButtonDown:
+    case OutputKind::ButtonUp:
+        if (!(in >> a))
+            return false;
+        out.event.button = static_cast<uint8_t>(a);
+        break;
+    default:
+        if (!(in >> a >> b))
+            return false;
+        out.event.dx = a;
+        out.event.dy = b;
+        break;
+    }
+    return true;
+}
+
+bool RecordingBackend::save(const std::string &path) const
+{
+    std::ofstream file(path);
+    if (!file.is_open())
+    {
+        return false;
+    }
+    file << "# NiftyKeys output trace: <time ns> <kind> <args>\n";
+    for (const RecordedEvent &recorded : *this)
+    {
+        write(file, recorded);
+        file << '\n';
+    }
+    return static_cast<bool>(file);
+}
+
+bool RecordingBackend::load(const std::string &path, std::vector<RecordedEvent> &out)
+{
+    std::ifstream file(path);
+    if (!file.is_open())
+    {
+        return false;
+    }
+    out.clear();
+    std::string line;
+    while (std::getline(file, line))
+    {
+        if (line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+        RecordedEvent recorded;
+        if (!parse(line, recorded))
+        {
+            return false;
+        }
+        out.push_back(recorded);
+    }
+    return true;
+}
+
+size_t RecordingBackend::diff(const std::vector<RecordedEvent> &golden, std::ostream &out, size_t maxReported) const
+{
+    size_t mismatches = 0;
+    const size_t longest = std::max(golden.size(), count);
+    for (size_t i = 0; i < longest; i++)
+    {
+        const bool haveExpected = i < golden.size();
+        const bool haveActual = i < count;
+        if (haveExpected && haveActual && golden[i] == events[i])
+        {
+            continue;
+        }
+        if (mismatches++ < maxReported)
+        {
+            out << "event " << i << ": expected ";
+            if (haveExpected)
+                write(out, golden[i]);
+            else
+                out << "<none>";
+            out << ", got ";
+            if (haveActual)
+                write(out, events[i]);
+            else
+                out << "<none>";
+            out << std::endl;
+        }
+    }
+    if (mismatches > maxReported)
+    {
+        out << "... " << mismatches - maxReported << " more differences" << std::endl;
+    }
+    return mismatches;
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "OutputBackend.h"
+
+// One recorded output event and the EventClock time it was submitted at. Under replay
+// the clock is a VirtualClock, so the times are deterministic.
+struct RecordedEvent
+{
+    uint64_t timestamp;
+    OutputEvent event;
+
+    bool operator==(const RecordedEvent &other) const
+    {
+        return timestamp == other.timestamp && event.kind == other.event.kind && event.button == other.event.button &&
+               event.vkCode == other.event.vkCode && event.dx == other.event.dx && event.dy == other.event.dy;
+    }
+    bool operator!=(const RecordedEvent &other) const { return !(*this == other); }
+};
+
+// Records everything it is given instead of sending it, so the modes can be run and
+// checked without moving the real cursor.
+//
+// Storage is allocated once, in the constructor; submit() only copies into it, so the
+// recorder is safe on the allocation-guarded hot path. Events past the capacity are
+// counted in overflowCount() and dropped. The pointer position is simulated by applying
+// the recorded moves to a desktop of the configured size. Not thread-safe: replay drives
+// the whole pipeline from one thread and submits here directly, without InjectionQueue.
+//
+// Traces are plain text, one event per line ("<ns> <kind> <args>"), and can be saved as
+// a golden trace and later diffed against a new recording.
+class RecordingBackend : public OutputBackend
+{
+public:
+    explicit RecordingBackend(size_t capacity = 65536);
+
+    void submit(const OutputEvent *batch, size_t count) override;
+    bool cursorPosition(int &x, int &y) override;
+
+    // Size of the simulated desktop; also re-centres the pointer.
+    void setDesktop(int width, int height);
+    void clear();
+
+    size_t size() const { return count; }
+    const RecordedEvent *begin() const { return events.data(); }
+    const RecordedEvent *end() const { return events.data() + count; }
+    const RecordedEvent &operator[](size_t index) const { return events[index]; }
+    uint64_t submitCount() const { return submits; }
+    uint64_t overflowCount() const { return overflows; }
+
+    bool save(const std::string &path) const;
+    static bool load(const std::string &path, std::vector<RecordedEvent> &out);
+    // Compare the recording with 'golden'. Prints up to 'maxReported' differing lines
+    // and returns the number of differing positions (0 means identical).
+    size_t diff(const std::vector<RecordedEvent> &golden, std::ostream &out, size_t maxReported = 10) const;
+
+    static void write(std::ostream &out, const RecordedEvent &recorded);
+    static bool parse(const std::string &line, RecordedEvent &out);
+
+private:
+    std::vector<RecordedEvent> events; // sized once; 'count' entries are in use
+    size_t count = 0;
+    uint64_t submits = 0;
+    uint64_t overflows = 0;
+    int width = 1920;
+    int height = 1080;
+    int cursorX = 960;
+    int cursorY = 540;
+};
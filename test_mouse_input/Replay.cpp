@@ -0,0 +1,353 @@
+#include "Replay.h"
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include "AllocationGuard.h"
+#include "DisplayGeometry.h"
+#include "EventClock.h"
+#include "HookCapture.h"
+#include "InjectionBatcher.h"
+#include "KeyEngine.h"
+#include "Macro.h"
+#include "Log.h"
+#include "ModeManager.h"
+#include "RecordingBackend.h"
+#ifdef __linux__
+#include "UinputBackend.h"
+#endif
+
+namespace
+{
+    void printUsage()
+    {
+        std::cerr << "usage: --replay <script> [--modes <modes.json>] [--golden <trace>] [--update-golden] [--uinput]"
+                     " [--max-events <n>]"
+                  << std::endl;
+    }
+
+    // systemNow() at START_TIME when the replay runs in real time (--uinput), 0 when it
+    // runs as fast as it can.
+    uint64_t realTimeStart = 0;
+
+    // Move virtual time to 'time', first waiting for the wall clock to catch up if the
+    // replay runs in real time.
+    void setTime(uint64_t time)
+    {
+        if (realTimeStart != 0)
+        {
+            const uint64_t due = realTimeStart + (time - Replay::START_TIME);
+            const uint64_t now = EventClock::systemNow();
+            if (due > now)
+            {
+                std::this_thread::sleep_for(std::chrono::nanoseconds(due - now));
+            }
+        }
+        VirtualClock::set(time);
+    }
+
+#ifdef __linux__
+    // Records every batch and also sends it to the real output.
+    class TeeBackend : public OutputBackend
+    {
+    public:
+        TeeBackend(OutputBackend &recorder, OutputBackend &output) : recorder(recorder), output(output) {}
+
+        void submit(const OutputEvent *events, size_t count) override
+        {
+            recorder.submit(events, count);
+            output.submit(events, count);
+        }
+        bool cursorPosition(int &x, int &y) override { return recorder.cursorPosition(x, y); }
+
+    private:
+        OutputBackend &recorder;
+        OutputBackend &output;
+    };
+#endif
+
+    // Run the polling thread's ticks and the engine's key repeats, in virtual time and in
+    // time order, up to and including 'until'.
+    uint64_t runTicks(uint64_t &pollTime, uint64_t until)
+    {
+        uint64_t ticks = 0;
+        for (;;)
+        {
+            const uint64_t repeatDue = Mode::repeater.nextDue();
+            if (repeatDue < pollTime && repeatDue <= until)
+            {
+                setTime(repeatDue);
+                KeyEngine::fireRepeats();
+                continue;
+            }
+            if (pollTime > until)
+            {
+                break;
+            }
+            setTime(pollTime);
+            const uint64_t interval = KeyEngine::tick();
+            pollTime = interval != KeyEngine::NO_TICK ? pollTime + interval : KeyEngine::NO_TICK;
+            ticks++;
+        }
+        return ticks;
+    }
+}
+
+int Replay::keyFromName(const std::string &name)
+{
+    if (name.size() > 2 && name[0] == '0' && (name[1] == 'x' || name[1] == 'X'))
+    {
+        return static_cast<int>(std::strtol(name.c_str() + 2, nullptr, 16)) & 0xFF;
+    }
+    return MacroCompiler::namedKey(name);
+}
+
+bool Replay::loadScript(const std::string &path, std::vector<ScriptEvent> &out)
+{
+    std::ifstream file(path);
+    if (!file.is_open())
+    {
+        std::cerr << "Error opening replay script: " << path << std::endl;
+        return false;
+    }
+    out.clear();
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line))
+    {
+        lineNumber++;
+        const size_t comment = line.find('#');
+        if (comment != std::string::npos)
+        {
+            line.erase(comment);
+        }
+        std::istringstream in(line);
+        double ms;
+        std::string action, key;
+        if (!(in >> ms))
+        {
+            continue; // blank line
+        }
+        ScriptEvent event;
+        event.time = static_cast<uint64_t>(ms * EventClock::MILLISECOND);
+        event.vkCode = 0;
+        event.isDown = false;
+        if (in >> action)
+        {
+            if (action == "end")
+            {
+                out.push_back(event);
+                continue;
+            }
+            if ((action == "down" || action == "up") && in >> key)
+            {
+                event.vkCode = keyFromName(key);
+                event.isDown = action == "down";
+            }
+        }
+        if (event.vkCode == 0)
+        {
+            std::cerr << path << ":" << lineNumber << ": expected '<ms> down|up <key>' or '<ms> end'" << std::endl;
+            return false;
+        }
+        if (!out.empty() && event.time < out.back().time)
+        {
+            std::cerr << path << ":" << lineNumber << ": events must be in time order" << std::endl;
+            return false;
+        }
+        out.push_back(event);
+    }
+    return true;
+}
+
+bool Replay::parseArguments(int argc, char *argv[], Options &options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+        if (arg == "--replay" && i + 1 < argc)
+            options.script = argv[++i];
+        else if (arg == "--modes" && i + 1 < argc)
+            options.modes = argv[++i];
+        else if (arg == "--golden" && i + 1 < argc)
+            options.golden = argv[++i];
+        else if (arg == "--update-golden")
+            options.updateGolden = true;
+        else if (arg == "--max-events" && i + 1 < argc)
+            options.maxEvents = static_cast<size_t>(std::strtoull(argv[++i], nullptr, 10));
+        else if (arg == "--uinput")
+        {
+#ifdef __linux__
+            options.uinput = true;
+#else
+            std::cerr << "--uinput is only available on Linux" << std::endl;
+            return false;
+#endif
+        }
+        else
+        {
+            printUsage();
+            return false;
+        }
+    }
+    if (options.script.empty() || (options.updateGolden && options.golden.empty()))
+    {
+        printUsage();
+        return false;
+    }
+    return true;
+}
+
+int Replay::run(const Options &options)
+{
+    std::vector<ScriptEvent> script;
+    if (!loadScript(options.script, script))
+    {
+        return 2;
+    }
+    Mode::loadModes(options.modes);
+
+    VirtualClock::install();
+    VirtualClock::set(START_TIME);
+    // Sized for the whole run up front, so recording never allocates on the hot path.
+    static RecordingBackend recorder(options.maxEvents);
+    // One 1920x1080 monitor at 96 dpi, so runs do not depend on the machine's displays.
+    MonitorInfo monitor;
+    monitor.right = REPLAY_DESKTOP_WIDTH;
+    monitor.bottom = REPLAY_DESKTOP_HEIGHT;
+    monitor.primary = 1;
+    DisplayLayout layout;
+    layout.build(&monitor, 1);
+    DisplayGeometry::publish(layout);
+    recorder.setDesktop(REPLAY_DESKTOP_WIDTH, REPLAY_DESKTOP_HEIGHT);
+    InjectionBatcher::setBackend(&recorder);
+#ifdef __linux__
+    static UinputBackend device;
+    static TeeBackend tee(recorder, device);
+    if (options.uinput)
+    {
+        if (!device.open(REPLAY_DESKTOP_WIDTH, REPLAY_DESKTOP_HEIGHT))
+        {
+            return 2;
+        }
+        InjectionBatcher::setBackend(&tee);
+    }
+#endif
+
+    const uint64_t wallStart = EventClock::systemNow();
+    realTimeStart = options.uinput ? wallStart : 0;
+    uint64_t pollTime = START_TIME;
+    uint64_t ticks = 0;
+    uint64_t endTime = START_TIME + (script.empty() ? 0 : script.back().time) + EventClock::SECOND;
+    KeyEvent captured;
+    for (const ScriptEvent &step : script)
+    {
+        const uint64_t time = START_TIME + step.time;
+        ticks += runTicks(pollTime, time);
+        setTime(time);
+        if (step.vkCode == 0)
+        {
+            endTime = time;
+            break;
+        }
+        KBDLLHOOKSTRUCT keyboard = {};
+        keyboard.vkCode = static_cast<DWORD>(step.vkCode);
+        keyboard.flags = step.isDown ? 0 : LLKHF_UP;
+        keyboard.time = static_cast<DWORD>(time / EventClock::MILLISECOND);
+        // As in the hook: OS autorepeats in the script are dropped before capture.
+        bool consumeRepeat = false;
+        if (HookCapture::filterRepeat(keyboard, step.isDown, consumeRepeat))
+        {
+            continue;
+        }
+        HookCapture::capture(keyboard, step.isDown);
+        while (HookCapture::ring.pop(captured))
+        {
+            KeyEngine::processKeyEvent(captured);
+        }
+        // What would wake the sleeping polling thread: tick now.
+        if (KeyEngine::tickWake.consume() && pollTime > time)
+        {
+            pollTime = time;
+        }
+    }
+    ticks += runTicks(pollTime, endTime);
+    const uint64_t wallElapsed = EventClock::systemNow() - wallStart;
+    EventClock::setSource(nullptr);
+    InjectionBatcher::setBackend(nullptr);
+#ifdef __linux__
+    device.close();
+#endif
+
+    const double virtualSeconds = static_cast<double>(endTime - START_TIME) / EventClock::SECOND;
+    const double wallSeconds = static_cast<double>(wallElapsed) / EventClock::SECOND;
+    std::cerr << "Replayed " << script.size() << " script events and " << ticks << " ticks: "
+              << virtualSeconds << " s of input in " << wallSeconds * 1000.0 << " ms";
+    if (wallSeconds > 0)
+    {
+        std::cerr << " (" << virtualSeconds / wallSeconds << "x real time)";
+    }
+    std::cerr << ", " << recorder.size() << " output events" << std::endl;
+    if (AllocationGuard::hotPathAllocations() > 0)
+    {
+        std::cerr << "Hot-path heap allocations: " << AllocationGuard::hotPathAllocations() << " (last one "
+                  << AllocationGuard::lastViolationSize() << " bytes)" << std::endl;
+        return 3;
+    }
+    // A truncated trace must neither pass against a golden trace nor become one.
+    if (recorder.overflowCount() > 0)
+    {
+        std::cerr << "Recording buffer overflowed; " << recorder.overflowCount() << " events were not kept"
+                  << " (raise --max-events)" << std::endl;
+        return 4;
+    }
+
+    if (options.updateGolden)
+    {
+        if (!recorder.save(options.golden))
+        {
+            std::cerr << "Error writing golden trace: " << options.golden << std::endl;
+            return 2;
+        }
+        std::cerr << "Golden trace written to " << options.golden << std::endl;
+        return 0;
+    }
+    if (!options.golden.empty())
+    {
+        std::vector<RecordedEvent> golden;
+        if (!RecordingBackend::load(options.golden, golden))
+        {
+            std::cerr << "Error reading golden trace: " << options.golden << std::endl;
+            return 2;
+        }
+        const size_t differences = recorder.diff(golden, std::cerr);
+        if (differences > 0)
+        {
+            std::cerr << "Trace differs from " << options.golden << " at " << differences << " positions" << std::endl;
+            return 1;
+        }
+        std::cerr << "Trace matches " << options.golden << std::endl;
+        return 0;
+    }
+    for (const RecordedEvent &recorded : recorder)
+    {
+        RecordingBackend::write(std::cout, recorded);
+        std::cout << '\n';
+    }
+    return 0;
+}
+
+int Replay::runFromArguments(int argc, char *argv[])
+{
+    Options options;
+    if (!parseArguments(argc, argv, options))
+    {
+        return 2;
+    }
+    Log::start();
+    const int result = run(options);
+    Log::stop();
+    return result;
+}
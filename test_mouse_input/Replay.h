@@ -0,0 +1,63 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Headless replay: feeds a scripted key sequence through the real pipeline (HookCapture,
+// KeyEngine, the loaded modes and their Update ticks) under a VirtualClock, records the
+// output with RecordingBackend, and either prints the trace, saves it as a golden trace or
+// diffs it against one. Unless --uinput is given, nothing touches the real keyboard or
+// pointer, and virtual time runs as fast as the CPU allows.
+//
+// Script format, one event per line ('#' starts a comment):
+//     <time ms> down <key>
+//     <time ms> up <key>
+//     <time ms> end            (optional; otherwise the run ends 1 s after the last event)
+// <key> is a single character ("a", ";"), a key name as in key_mapping braces (space,
+// enter, f5, ctrl, ...; see MacroCompiler) or a virtual-key code in hex ("0x41").
+//
+// Command line:
+//     --replay <script> [--modes <modes.json>] [--golden <trace>] [--update-golden] [--uinput]
+//              [--max-events <n>]
+// With --golden the recording is compared against the trace and the exit code is 1 if they
+// differ; --update-golden rewrites the trace instead. Without --golden the trace is printed.
+// Bad arguments or files exit with 2. In a build with NK_ALLOCATION_GUARD, any heap
+// allocation on the hot path fails the run with exit code 3. The recording holds up to
+// --max-events output events (default 1M); a run that produces more exits with 4 and
+// neither compares nor saves the truncated trace.
+// --uinput (Linux only) also sends the output to virtual uinput devices (see UinputBackend)
+// and runs the script in real time, so it really types and moves the pointer.
+class Replay
+{
+public:
+    struct ScriptEvent
+    {
+        uint64_t time; // ns from the start of the script
+        int vkCode;    // 0 marks the end of the script
+        bool isDown;
+    };
+
+    struct Options
+    {
+        std::string script;
+        std::string modes = "modes.json";
+        std::string golden;
+        bool updateGolden = false;
+        bool uinput = false;
+        size_t maxEvents = 1 << 20; // recording capacity, allocated before the run
+    };
+
+    // Parse "--replay ..." arguments. Returns false (after printing usage) if they are invalid.
+    static bool parseArguments(int argc, char *argv[], Options &options);
+    static int run(const Options &options);
+    static int runFromArguments(int argc, char *argv[]);
+
+    static bool loadScript(const std::string &path, std::vector<ScriptEvent> &out);
+    static int keyFromName(const std::string &name);
+
+    // Virtual time the script's time 0 maps to. Non-zero so "never pressed" (0) stays distinct.
+    static constexpr uint64_t START_TIME = 1000000000ull;
+    // The synthetic display replay runs on.
+    static constexpr int REPLAY_DESKTOP_WIDTH = 1920;
+    static constexpr int REPLAY_DESKTOP_HEIGHT = 1080;
+};
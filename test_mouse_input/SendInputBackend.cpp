@@ -0,0 +1,112 @@
+#include "SendInputBackend.h"
+#include "HookStats.h"
+
+size_t SendInputBackend::translate(const OutputEvent &event, INPUT *out)
+{
+    INPUT &input = out[0];
+    input = INPUT();
+    switch (event.kind)
+    {
+    case OutputKind::KeyDown:
+    case OutputKind::KeyUp:
+        input.type = INPUT_KEYBOARD;
+        input.ki.wVk = event.vkCode;
+        input.ki.dwFlags = event.kind == OutputKind::KeyUp ? KEYEVENTF_KEYUP : 0;
+        input.ki.dwExtraInfo = HookCapture::injectionSignature();
+        return 1;
+    case OutputKind::MouseMove:
+        input.type = INPUT_MOUSE;
+        input.mi.dx = event.dx;
+        input.mi.dy = event.dy;
+        input.mi.dwFlags = MOUSEEVENTF_MOVE;
+        input.mi.dwExtraInfo = HookCapture::injectionSignature();
+        return 1;
+    case OutputKind::MouseMoveTo:
+    {
+        // Absolute coordinates are 0..65535 across the whole virtual desktop.
+        const int left = GetSystemMetrics(SM_XVIRTUALSCREEN);
+        const int top = GetSystemMetrics(SM_YVIRTUALSCREEN);
+        const int width = GetSystemMetrics(SM_CXVIRTUALSCREEN);
+        const int height = GetSystemMetrics(SM_CYVIRTUALSCREEN);
+        input.type = INPUT_MOUSE;
+        input.mi.dx = width > 1 ? MulDiv(event.dx - left, 65535, width - 1) : 0;
+        input.mi.dy = height > 1 ? MulDiv(event.dy - top, 65535, height - 1) : 0;
+        input.mi.dwFlags = MOUSEEVENTF_MOVE | MOUSEEVENTF_ABSOLUTE | MOUSEEVENTF_VIRTUALDESK;
+        input.mi.dwExtraInfo = HookCapture::injectionSignature();
+        return 1;
+    }
+    case OutputKind::ButtonDown:
+    case OutputKind::ButtonUp:
+    {
+        const bool down = event.kind == OutputKind::ButtonDown;
+        input.type = INPUT_MOUSE;
+        switch (event.button)
+        {
+        case MOUSE_LEFT:
+            input.mi.dwFlags = down ? MOUSEEVENTF_LEFTDOWN : MOUSEEVENTF_LEFTUP;
+            break;
+        case MOUSE_RIGHT:
+            input.mi.dwFlags = down ? MOUSEEVENTF_RIGHTDOWN : MOUSEEVENTF_RIGHTUP;
+            break;
+        default:
+            input.mi.dwFlags = down ? MOUSEEVENTF_MIDDLEDOWN : MOUSEEVENTF_MIDDLEUP;
+            break;
+        }
+        input.mi.dwExtraInfo = HookCapture::injectionSignature();
+        return 1;
+    }
+    case OutputKind::Wheel:
+    {
+        // Windows has one INPUT per wheel axis.
+        size_t count = 0;
+        if (event.dy != 0)
+        {
+            INPUT &vertical = out[count++];
+            vertical = INPUT();
+            vertical.type = INPUT_MOUSE;
+            vertical.mi.mouseData = static_cast<DWORD>(event.dy);
+            vertical.mi.dwFlags = MOUSEEVENTF_WHEEL;
+            vertical.mi.dwExtraInfo = HookCapture::injectionSignature();
+        }
+        if (event.dx != 0)
+        {
+            INPUT &horizontal = out[count++];
+            horizontal = INPUT();
+            horizontal.type = INPUT_MOUSE;
+            horizontal.mi.mouseData = static_cast<DWORD>(event.dx);
+            horizontal.mi.dwFlags = MOUSEEVENTF_HWHEEL;
+            horizontal.mi.dwExtraInfo = HookCapture::injectionSignature();
+        }
+        return count;
+    }
+    }
+    return 0;
+}
+
+void SendInputBackend::submit(const OutputEvent *events, size_t count)
+{
+    // Batches are small (InjectionBatcher caps them), so the INPUT array lives on the stack.
+    INPUT inputs[MAX_INPUTS];
+    size_t used = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        if (used + MAX_INPUTS_PER_EVENT > MAX_INPUTS)
+        {
+            send(inputs, used);
+            used = 0;
+        }
+        used += translate(events[i], inputs + used);
+    }
+    send(inputs, used);
+}
+
+void SendInputBackend::send(INPUT *inputs, size_t count)
+{
+    if (count == 0)
+    {
+        return;
+    }
+    uint64_t start = HookStats::now();
+    SendInput(static_cast<UINT>(count), inputs, sizeof(INPUT));
+    HookStats::record(HookStats::SEND_INPUT, start, HookStats::now());
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <windows.h>
+#include "OutputBackend.h"
+#include "HookCapture.h"
+
+// The Win32 backend: each batch becomes one contiguous INPUT array and one SendInput call.
+// Every INPUT is stamped with HookCapture::injectionSignature() so the hook lets it through.
+class SendInputBackend : public OutputBackend
+{
+public:
+    void submit(const OutputEvent *events, size_t count) override;
+
+    bool cursorPosition(int &x, int &y) override
+    {
+        POINT pos;
+        if (!GetCursorPos(&pos))
+        {
+            return false;
+        }
+        x = pos.x;
+        y = pos.y;
+        return true;
+    }
+
+private:
+    static constexpr size_t MAX_INPUTS = 128;
+    static constexpr size_t MAX_INPUTS_PER_EVENT = 2; // a two-axis wheel event
+
+    // Fill out[0..n) for one event and return n.
+    static size_t translate(const OutputEvent &event, INPUT *out);
+    static void send(INPUT *inputs, size_t count);
+};
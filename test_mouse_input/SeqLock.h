@@ -0,0 +1,96 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// Sequence lock for one writer and any number of readers.
+//
+// The writer bumps the sequence to an odd value, updates the protected data and bumps it
+// back to even; it never waits for anybody. A reader notes the sequence, copies the data
+// and checks the sequence again, retrying only if a write overlapped its copy. The
+// protected data itself must be made of atomics read and written with relaxed ordering,
+// which keeps the overlapping accesses well-defined.
+class SeqLock
+{
+public:
+    void beginWrite()
+    {
+        sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    void endWrite()
+    {
+        sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Start of a read: waits out a write that is in progress and returns the sequence to pass to readRetry().
+    uint64_t readBegin() const
+    {
+        uint64_t start = sequence.load(std::memory_order_acquire);
+        while (start & 1)
+        {
+            start = sequence.load(std::memory_order_acquire);
+        }
+        return start;
+    }
+
+    // End of a read: true if a write overlapped it and the copy must be thrown away.
+    bool readRetry(uint64_t start) const
+    {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return sequence.load(std::memory_order_relaxed) != start;
+    }
+
+    // Even, and bumped by two for every completed write.
+    uint64_t version() const { return sequence.load(std::memory_order_acquire); }
+
+private:
+    std::atomic<uint64_t> sequence{0};
+};
+
+// A small trivially copyable value published through a SeqLock: the writer replaces it
+// as a whole, readers always get a value that was actually stored.
+template <typename T>
+class SeqLocked
+{
+    static_assert(std::is_trivially_copyable<T>::value, "SeqLocked needs a trivially copyable type");
+
+public:
+    void store(const T &value)
+    {
+        uint64_t buffer[WORDS] = {};
+        std::memcpy(buffer, &value, sizeof(T));
+        lock.beginWrite();
+        for (size_t i = 0; i < WORDS; i++)
+        {
+            words[i].store(buffer[i], std::memory_order_relaxed);
+        }
+        lock.endWrite();
+    }
+
+    T load() const
+    {
+        uint64_t buffer[WORDS];
+        uint64_t start;
+        do
+        {
+            start = lock.readBegin();
+            for (size_t i = 0; i < WORDS; i++)
+            {
+                buffer[i] = words[i].load(std::memory_order_relaxed);
+            }
+        } while (lock.readRetry(start));
+        T value;
+        std::memcpy(&value, buffer, sizeof(T));
+        return value;
+    }
+
+    uint64_t version() const { return lock.version(); }
+
+private:
+    static constexpr size_t WORDS = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+    SeqLock lock;
+    std::atomic<uint64_t> words[WORDS] = {};
+};
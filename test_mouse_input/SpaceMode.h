@@ -1,25 +1,168 @@
 #pragma once
+#include "Win32Compat.h"
 #include "ModeManager.h"
 #include "InputSimulator.h"
+#include "MotionIntegrator.h"
+#include "DisplayGeometry.h"
+#include "TapHistory.h"
+#include "Log.h"
 class SpaceMode : public Mode
 {
-    // ms for space tap vs. mode
-    const double ACCELERATION = 2.0;
-    const double FRICTION = 0.85;
-    const double MAX_SPEED = 50.0;
-    double mouseVelX = 0.0, mouseVelY = 0.0;
-    const DWORD RAPID_THRESHOLD = 100; // ms
+    // Motion is integrated in fixed steps of real time (see FixedTimestep), so it feels the
+    // same however often Update() runs. How it accelerates and glides comes from the
+    // profiles ("classic" unless modes.json picks another; see MotionProfile).
+    MotionProfile cursorProfile, scrollProfile;
+    FixedTimestep timestep;
+    MotionAxisIntegrator motionX, motionY;
+    MotionAxisIntegrator scrollX, scrollY;
+    // Our copy of the monitor layout, re-copied only when DisplayGeometry publishes a new one.
+    DisplayLayout display;
+    uint64_t displayVersion = 0;
+    // The engine thread's own copy, for leaps.
+    DisplayLayout leapDisplay;
+    uint64_t leapDisplayVersion = 0;
+    // The last leap on each axis (0 horizontal, 1 vertical); see leap().
+    struct Leap
+    {
+        int distance = 0;
+        uint64_t time = 0;
+    };
+    Leap leaps[2];
+    // Keys bound to each MotionAxis, as bit masks over the held-key bitmap.
+    KeyBitmap axisKeys[4];
+    // Keys bound to each ScrollAxis.
+    KeyBitmap scrollKeys[4];
+    // Key state as of the current Update(); only the physics thread touches it.
+    KeySnapshot keys;
     // constructor
 public:
     SpaceMode(const std::string &name, const std::unordered_map<int, int> &keymapping, const std::vector<int> &keyCodes)
         : Mode(name, keymapping, keyCodes)
     {
+        MotionProfile::preset("classic", MotionProfile::CURSOR, cursorProfile);
+        MotionProfile::preset("classic", MotionProfile::SCROLL, scrollProfile);
+        setTimestep(FixedTimestep::DEFAULT_STEP);
+        // Motion goes out at 125 Hz unless modes.json says otherwise.
+        setTickInterval(8 * EventClock::MILLISECOND);
+    }
+
+    // Length of one physics step, in ns. Shorter steps follow key presses more closely.
+    uint64_t timestepLength() const { return timestep.step(); }
+    void setTimestep(uint64_t step)
+    {
+        timestep.setStep(step);
+        motionX.configure(&cursorProfile, timestep.stepSeconds());
+        motionY.configure(&cursorProfile, timestep.stepSeconds());
+        scrollX.configure(&scrollProfile, timestep.stepSeconds());
+        scrollY.configure(&scrollProfile, timestep.stepSeconds());
+    }
+
+    void setProfiles(const MotionProfile &cursor, const MotionProfile &scroll)
+    {
+        cursorProfile = cursor;
+        scrollProfile = scroll;
+    }
+
+    void compileDispatch() override
+    {
+        // Mouse buttons.
+        dispatch['Q'] = {KeyActionKind::MouseButton, MOUSE_LEFT};
+        dispatch['E'] = {KeyActionKind::MouseButton, MOUSE_RIGHT};
+        dispatch['H'] = {KeyActionKind::MouseButton, MOUSE_MIDDLE};
+        // Movement: WASD on the left hand, KOL; on the right.
+        bindMotion('A', MOTION_LEFT);
+        bindMotion('K', MOTION_LEFT);
+        bindMotion('D', MOTION_RIGHT);
+        bindMotion(VK_OEM_1, MOTION_RIGHT);
+        bindMotion('W', MOTION_UP);
+        bindMotion('O', MOTION_UP);
+        bindMotion('S', MOTION_DOWN);
+        bindMotion('L', MOTION_DOWN);
+        // Scrolling: R/F vertical, Z/X horizontal.
+        bindScroll('R', SCROLL_UP);
+        bindScroll('F', SCROLL_DOWN);
+        bindScroll('Z', SCROLL_LEFT);
+        bindScroll('X', SCROLL_RIGHT);
+    }
+
+    void bindMotion(int vkCode, MotionAxis axis)
+    {
+        dispatch[vkCode] = {KeyActionKind::MotionAxis, axis};
+        axisKeys[axis].set(vkCode);
+    }
+
+    void bindScroll(int vkCode, ScrollAxis axis)
+    {
+        dispatch[vkCode] = {KeyActionKind::ScrollAxis, axis};
+        scrollKeys[axis].set(vkCode);
+    }
+
+    // Net push along one direction from the keys held in 'keys'. Each held key pushes
+    // once; holding both of a direction's keys multiplies that by the profile's bothKeys.
+    double axisThrust(MotionAxis axis) const
+    {
+        int held = keys.held.countIn(axisKeys[axis]);
+        return held > 1 ? held * cursorProfile.bothKeys : held;
+    }
+
+    double scrollThrust(ScrollAxis positive, ScrollAxis negative) const
+    {
+        return keys.held.countIn(scrollKeys[positive]) - keys.held.countIn(scrollKeys[negative]);
     }
 
-    bool handleKeyDownEvent(int vkCode)
+    // Rapid re-presses of a direction key leap towards that edge of the monitor under the
+    // cursor. A double tap goes half-way; while the taps keep coming, every further press of
+    // either key on that axis leaps half as far as the last leap, in its own direction, so a
+    // few taps binary-search the cursor onto its target. Each leap is one absolute move.
+    // Engine thread.
+    void leap(MotionAxis axis, int vkCode, uint64_t timestamp)
+    {
+        const bool horizontal = axis == MOTION_LEFT || axis == MOTION_RIGHT;
+        Leap &last = leaps[horizontal ? 0 : 1];
+        const bool continuing = last.distance > 1 && timestamp - last.time <= keyTaps.getWindow();
+        if (!continuing && keyTaps.runLength(vkCode) < 2)
+        {
+            return;
+        }
+        int x, y;
+        if (!InputSimulator::cursorPosition(x, y))
+        {
+            return;
+        }
+        DisplayGeometry::update(leapDisplay, leapDisplayVersion);
+        const int index = leapDisplay.nearestMonitor(x, y);
+        if (index == DisplayLayout::NO_MONITOR)
+        {
+            return;
+        }
+        const MonitorInfo &monitor = leapDisplay.monitor(index);
+        const int position = horizontal ? x : y;
+        const int low = horizontal ? monitor.left : monitor.top;
+        const int high = (horizontal ? monitor.right : monitor.bottom) - 1;
+        const bool towardsHigh = axis == MOTION_RIGHT || axis == MOTION_DOWN;
+        const int distance = continuing ? last.distance / 2 : (towardsHigh ? high - position : position - low) / 2;
+        int target = towardsHigh ? position + distance : position - distance;
+        target = std::max(low, std::min(high, target));
+        last.distance = distance;
+        last.time = timestamp;
+        if (target == position)
+        {
+            return;
+        }
+        LOG_DEBUG("Leap {} px to {}", distance, target);
+        if (horizontal)
+        {
+            InputSimulator::moveMouseTo(target, y);
+        }
+        else
+        {
+            InputSimulator::moveMouseTo(x, target);
+        }
+    }
+
+    bool handleKeyDownEvent(int vkCode, uint64_t timestamp) override
     {
         bool handled = false;
-        DWORD now = GetTickCount64();
         // if already held, return true.
         if (isKeyAlreadyHeld(vkCode))
         {
@@ -27,183 +170,132 @@ public:
         }
         else
         {
-            switch (vkCode)
+            const KeyAction &action = dispatch[vkCode];
+            if (action.kind == KeyActionKind::MouseButton)
             {
-            case 'Q':
-            { // Left mouse button.
-                InputSimulator::simulateLeftDown();
-                handled = true;
-                break;
-            }
-            case 'E':
-            { // Right mouse button.k
-                InputSimulator::simulateRightDown();
-                handled = true;
-                break;
-            }   
-            case 'H':
-            { // Middle mouse button.
-                InputSimulator::simulateMiddleDown();
-                handled = true;
+                switch (action.target)
+                {
+                case MOUSE_LEFT:
+                    InputSimulator::simulateLeftDown();
+                    break;
+                case MOUSE_RIGHT:
+                    InputSimulator::simulateRightDown();
+                    break;
+                case MOUSE_MIDDLE:
+                    InputSimulator::simulateMiddleDown();
+                    break;
+                }
             }
-            // mark it also as handled if awsd k, l, ; were pressed.
-            case 'A':
-            case 'W':
-            case 'S':
-            case 'D':
-            case 'K':
-            case 'L':
-            case 'O':
-            case VK_OEM_1:
-                handled = true;
-                break;
-            default:
-
-                break;
+            else if (action.kind == KeyActionKind::MotionAxis)
+            {
+                leap(static_cast<MotionAxis>(action.target), vkCode, timestamp);
             }
+            // Auto-clicks a held mouse-button key if repeat_mouse_buttons is set.
+            repeater.start(vkCode, action, repeatSettings, timestamp);
+            // Motion and scroll keys are only marked as handled; Update() reads them from keyStates.
+            handled = action.consumes();
         }
         return handled;
     }
 
-    bool handleKeyUpEvent(int vkCode)
+    bool handleKeyUpEvent(int vkCode, uint64_t) override
     {
-        bool handled = false;
-
-        switch (vkCode)
+        const KeyAction &action = dispatch[vkCode];
+        repeater.stop(vkCode);
+        if (action.kind == KeyActionKind::MouseButton)
         {
-        case 'Q':
-            InputSimulator::simulateLeftUp();
-            handled = true;
-
-            break;
-
-        case 'E':
-            // Right mouse button.
-            InputSimulator::simulateRightUp();
-            handled = true;
-            break;
-
-        case 'H':
-            InputSimulator::simulateMiddleUp();
-            handled = true;
-            break;
-        case 'A':
-        case 'W':
-        case 'S':
-        case 'D':
-        case 'K':
-        case 'L':
-        case 'O':
-        case VK_OEM_1:
-            handled = true;
-            break;
-        default:
-
-            break;
+            switch (action.target)
+            {
+            case MOUSE_LEFT:
+                InputSimulator::simulateLeftUp();
+                break;
+            case MOUSE_RIGHT:
+                InputSimulator::simulateRightUp();
+                break;
+            case MOUSE_MIDDLE:
+                InputSimulator::simulateMiddleUp();
+                break;
+            }
         }
-        return handled;
+        return action.consumes();
     }
     bool isKeyAlreadyHeld(int vkCode)
     {
-        std::lock_guard<std::mutex> lock(keyStatesMutex);
-        return keyStates.count(vkCode) && keyStates[vkCode].held;
+        return keyStates.isHeld(vkCode);
     }
     void Update() override
     {
 
-        // First, check for leap jumps.
-        POINT pos;
-        if (GetCursorPos(&pos))
+        int cursorX, cursorY;
+        if (InputSimulator::cursorPosition(cursorX, cursorY))
         {
-            int screenWidth = GetSystemMetrics(SM_CXSCREEN);
-            int screenHeight = GetSystemMetrics(SM_CYSCREEN);
-            double accelX = 0.0, accelY = 0.0;
+            // One consistent read of every key; the hook side never waits for it.
+            keyStates.snapshot(keys);
+            const double thrustX = axisThrust(MOTION_RIGHT) - axisThrust(MOTION_LEFT);
+            const double thrustY = axisThrust(MOTION_DOWN) - axisThrust(MOTION_UP);
+            const double thrustUp = scrollThrust(SCROLL_UP, SCROLL_DOWN);
+            const double thrustRight = scrollThrust(SCROLL_RIGHT, SCROLL_LEFT);
+            for (uint32_t steps = timestep.advance(EventClock::now()); steps > 0; steps--)
             {
-                std::lock_guard<std::mutex> lock(keyStatesMutex);
-
-                // Check leftward keys: 'A' and 'J'
-                bool leftA = (keyStates.count('A') && keyStates['A'].held);
-                bool leftJ = (keyStates.count('K') && keyStates['K'].held);
-                if (leftA || leftJ)
-                {
-                    double leftAccel = 0.0;
-                    if (leftA)
-                        leftAccel -= ACCELERATION;
-                    if (leftJ)
-                        leftAccel -= ACCELERATION;
-                    if (leftA && leftJ)
-                        leftAccel *= 3;
-                    accelX += leftAccel;
-                }
-
-                // Check rightward keys: 'D' and VK_OEM_1 (semicolon)
-                bool rightD = (keyStates.count('D') && keyStates['D'].held);
-                bool rightSemicolon = (keyStates.count(VK_OEM_1) && keyStates[VK_OEM_1].held);
-                if (rightD || rightSemicolon)
-                {
-                    double rightAccel = 0.0;
-                    if (rightD)
-                        rightAccel += ACCELERATION;
-                    if (rightSemicolon)
-                        rightAccel += ACCELERATION;
-                    if (rightD && rightSemicolon)
-                        rightAccel *= 3;
-                    accelX += rightAccel;
-                }
-
-                // Check upward keys: 'W' and 'K'
-                bool upW = (keyStates.count('W') && keyStates['W'].held);
-                bool upK = (keyStates.count('O') && keyStates['O'].held);
-                if (upW || upK)
+                motionX.step(thrustX);
+                motionY.step(thrustY);
+                scrollY.step(thrustUp);
+                scrollX.step(thrustRight);
+            }
+            int moveX = motionX.take();
+            int moveY = motionY.take();
+            // Stop at the edge of the desktop instead of building up speed against it.
+            DisplayGeometry::update(display, displayVersion);
+            int targetX = cursorX + moveX;
+            int targetY = cursorY + moveY;
+            if (display.clamp(targetX, targetY))
+            {
+                if (targetX != cursorX + moveX)
                 {
-                    double upAccel = 0.0;
-                    if (upW)
-                        upAccel -= ACCELERATION;
-                    if (upK)
-                        upAccel -= ACCELERATION;
-                    if (upW && upK)
-                        upAccel *= 3;
-                    accelY += upAccel;
+                    motionX.stop();
                 }
-
-                // Check downward keys: 'S' and 'L'
-                bool downS = (keyStates.count('S') && keyStates['S'].held);
-                bool downL = (keyStates.count('L') && keyStates['L'].held);
-                if (downS || downL)
+                if (targetY != cursorY + moveY)
                 {
-                    double downAccel = 0.0;
-                    if (downS)
-                        downAccel += ACCELERATION;
-                    if (downL)
-                        downAccel += ACCELERATION;
-                    if (downS && downL)
-                        downAccel *= 3;
-                    accelY += downAccel;
+                    motionY.stop();
                 }
+                moveX = targetX - cursorX;
+                moveY = targetY - cursorY;
             }
-
-            mouseVelX += accelX;
-            mouseVelY += accelY;
-            if (accelX == 0.0)
-                mouseVelX *= FRICTION;
-            if (accelY == 0.0)
-                mouseVelY *= FRICTION;
-            if (std::abs(mouseVelX) > MAX_SPEED)
-                mouseVelX = (mouseVelX > 0 ? MAX_SPEED : -MAX_SPEED);
-            if (std::abs(mouseVelY) > MAX_SPEED)
-                mouseVelY = (mouseVelY > 0 ? MAX_SPEED : -MAX_SPEED);
-            int moveX = static_cast<int>(std::round(mouseVelX));
-            int moveY = static_cast<int>(std::round(mouseVelY));
             if (moveX != 0 || moveY != 0)
             {
                 InputSimulator::moveMouse(moveX, moveY);
             }
+            // At most one wheel event per Update(), however fast the scroll.
+            const int wheelUp = scrollY.take();
+            const int wheelRight = scrollX.take();
+            if (wheelUp != 0 || wheelRight != 0)
+            {
+                InputSimulator::scrollWheel(wheelRight, wheelUp);
+            }
+            // Going idle: the time until the next key press must not count as motion.
+            if (!needsTicks())
+            {
+                timestep.restart();
+            }
         }
         else
         {
-            mouseVelX = 0.0;
-            mouseVelY = 0.0;
+            motionX.stop();
+            motionY.stop();
+            timestep.restart();
+        }
+    }
+
+    // Keep ticking while a motion or scroll key is held or anything is still coasting.
+    bool needsTicks() const override
+    {
+        for (int axis = 0; axis < 4; axis++)
+        {
+            if (keys.held.countIn(axisKeys[axis]) > 0 || keys.held.countIn(scrollKeys[axis]) > 0)
+            {
+                return true;
+            }
         }
-        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        return motionX.moving() || motionY.moving() || scrollX.moving() || scrollY.moving();
     }
 };
@@ -0,0 +1,39 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+
+// Turns a stream of fractional pixel deltas into whole-pixel moves without losing the
+// fractions. Each delta is converted once to 16.16 fixed point and added to a running
+// total; add() returns the whole pixels in that total (truncated toward zero, so left and
+// right motion behave the same) and keeps the rest for the next call. Over any number of
+// calls the pixels returned plus remainder() equal the sum of the fixed-point deltas
+// exactly, so slow motion still moves, friction tails decay smoothly and diagonals don't
+// drift.
+class SubpixelAccumulator
+{
+public:
+    static constexpr int FRACTION_BITS = 16;
+    static constexpr int64_t ONE = int64_t(1) << FRACTION_BITS;
+
+    static int64_t toFixed(double pixels) { return static_cast<int64_t>(std::llround(pixels * ONE)); }
+
+    // Add 'pixels' and return the whole pixels now ready to send.
+    int add(double pixels) { return addFixed(toFixed(pixels)); }
+
+    int addFixed(int64_t delta)
+    {
+        total += delta;
+        const int64_t whole = total / ONE; // C++ division truncates toward zero
+        total -= whole * ONE;
+        return static_cast<int>(whole);
+    }
+
+    // The fraction of a pixel carried over, in (-1, 1).
+    double remainder() const { return static_cast<double>(total) / ONE; }
+    int64_t remainderFixed() const { return total; }
+
+    void reset() { total = 0; }
+
+private:
+    int64_t total = 0;
+};
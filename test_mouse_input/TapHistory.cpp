@@ -0,0 +1,3 @@
+#include "TapHistory.h"
+
+TapHistory keyTaps;
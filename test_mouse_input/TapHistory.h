@@ -0,0 +1,63 @@
+#pragma once
+#include <cstdint>
+#include "EventClock.h"
+
+// The last few press times of every key, for spotting double and triple taps.
+//
+// Each key has a small ring of press timestamps (the event's own time, from the hook) and
+// the length of its current run of rapid presses: a press within the window of the one
+// before extends the run, anything slower starts a new one. record() and runLength() are
+// a handful of loads and stores, whatever the window. Engine thread only; KeyEngine
+// records every press before the active mode sees it, so any mode can ask how many
+// times in a row its key was just tapped.
+class TapHistory
+{
+public:
+    static constexpr int CAPACITY = 4; // press times kept per key
+    static constexpr uint64_t DEFAULT_WINDOW = 200 * EventClock::MILLISECOND;
+
+    void setWindow(uint64_t newWindow) { window = newWindow; }
+    uint64_t getWindow() const { return window; }
+
+    void record(int vkCode, uint64_t timestamp)
+    {
+        Key &key = keys[vkCode & 0xFF];
+        const uint64_t previous = key.times[key.head];
+        key.run = key.run > 0 && timestamp - previous <= window ? key.run + 1 : 1;
+        key.head = (key.head + 1) % CAPACITY;
+        key.times[key.head] = timestamp;
+    }
+
+    // Presses in the current rapid run, counting the latest: 1 for a single press, 2 for
+    // a double tap, and so on. 0 if the key was never pressed.
+    uint32_t runLength(int vkCode) const { return keys[vkCode & 0xFF].run; }
+
+    // Time of the 'back'-th most recent press (0 = the latest), up to CAPACITY - 1 back;
+    // 0 if there was none.
+    uint64_t pressTime(int vkCode, int back) const
+    {
+        const Key &key = keys[vkCode & 0xFF];
+        return key.times[(key.head + CAPACITY - back % CAPACITY) % CAPACITY];
+    }
+
+    void clear()
+    {
+        for (Key &key : keys)
+        {
+            key = Key();
+        }
+    }
+
+private:
+    struct Key
+    {
+        uint64_t times[CAPACITY] = {};
+        uint32_t run = 0;
+        uint8_t head = 0;
+    };
+
+    Key keys[256];
+    uint64_t window = DEFAULT_WINDOW;
+};
+
+extern TapHistory keyTaps;
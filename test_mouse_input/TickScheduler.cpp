@@ -0,0 +1,94 @@
+#include "TickScheduler.h"
+#include <cerrno>
+#include <chrono>
+#include <thread>
+#include "HookStats.h"
+#ifndef _WIN32
+#include <time.h>
+#endif
+
+#if defined(_WIN32) && !defined(CREATE_WAITABLE_TIMER_HIGH_RESOLUTION)
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+TickScheduler::TickScheduler()
+{
+#ifdef _WIN32
+    timer = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+    highRes = timer != NULL;
+    if (timer == NULL)
+    {
+        // Older Windows: an ordinary timer, as coarse as the system tick.
+        timer = CreateWaitableTimerExW(NULL, NULL, 0, TIMER_ALL_ACCESS);
+    }
+#elif defined(__linux__)
+    highRes = true;
+#endif
+}
+
+TickScheduler::~TickScheduler()
+{
+#ifdef _WIN32
+    if (timer != NULL)
+    {
+        CloseHandle(timer);
+    }
+#endif
+}
+
+void TickScheduler::waitNext(uint64_t interval)
+{
+    const uint64_t now = EventClock::systemNow();
+    if (deadline == 0 || now > deadline + interval)
+    {
+        deadline = now;
+    }
+    deadline += interval;
+    const uint64_t spin = spinFor(interval);
+    if (deadline - spin > now)
+    {
+        sleepUntil(deadline - spin);
+    }
+    if (spin > 0)
+    {
+        while (EventClock::systemNow() < deadline)
+        {
+            std::this_thread::yield();
+        }
+    }
+    const uint64_t woke = EventClock::systemNow();
+    HookStats::record(HookStats::TICK_JITTER, deadline, woke > deadline ? woke : deadline);
+}
+
+void TickScheduler::sleepUntil(uint64_t when)
+{
+    const uint64_t now = EventClock::systemNow();
+    if (when <= now)
+    {
+        return;
+    }
+#ifdef _WIN32
+    if (timer != NULL)
+    {
+        // Relative due time in 100 ns units; the timer has no notion of our clock.
+        LARGE_INTEGER due;
+        due.QuadPart = -static_cast<LONGLONG>((when - now + 99) / 100);
+        if (SetWaitableTimer(timer, &due, 0, NULL, NULL, FALSE))
+        {
+            WaitForSingleObject(timer, INFINITE);
+            return;
+        }
+    }
+    std::this_thread::sleep_for(std::chrono::nanoseconds(when - now));
+#elif defined(__linux__)
+    // systemNow() is CLOCK_MONOTONIC, so the deadline can be used as is.
+    timespec target;
+    target.tv_sec = static_cast<time_t>(when / EventClock::SECOND);
+    target.tv_nsec = static_cast<long>(when % EventClock::SECOND);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &target, nullptr) == EINTR)
+    {
+    }
+#else
+    std::this_thread::sleep_for(std::chrono::nanoseconds(when - now));
+#endif
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include "EventClock.h"
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+// Paces the polling thread's ticks against absolute deadlines.
+//
+// Each tick is due one interval after the previous deadline, not after the previous wake,
+// so lateness never accumulates. Sleeping uses a high-resolution waitable timer on Windows
+// (std::this_thread::sleep_for rounds up to the ~15.6 ms system tick there) and
+// clock_nanosleep with an absolute CLOCK_MONOTONIC deadline on Linux. An optional spin
+// phase sleeps until shortly before the deadline and busy-waits the rest, trading a little
+// CPU for punctuality.
+//
+// How late each wake was goes to HookStats::TICK_JITTER.
+class TickScheduler
+{
+public:
+    TickScheduler();
+    ~TickScheduler();
+    TickScheduler(const TickScheduler &) = delete;
+    TickScheduler &operator=(const TickScheduler &) = delete;
+
+    // Busy-wait this long (ns) before each deadline; 0 turns spinning off. Each wait spins
+    // at most spinFor() of it.
+    void setSpin(uint64_t spin) { spinTime = spin; }
+
+    // The spin used between ticks 'interval' apart: at most half the interval, so a spin
+    // as long as the tick does not busy-wait the whole period.
+    static uint64_t spinFor(uint64_t spin, uint64_t interval) { return std::min(spin, interval / 2); }
+    uint64_t spinFor(uint64_t interval) const { return spinFor(spinTime, interval); }
+
+    // Forget the previous deadline: the next wait counts from now.
+    void restart() { deadline = 0; }
+
+    // Sleep until the next tick, 'interval' after the previous deadline. If we have fallen
+    // more than a whole interval behind, the schedule restarts from now instead of
+    // ticking back-to-back to catch up.
+    void waitNext(uint64_t interval);
+
+    // True if the high-resolution timer is in use (Windows 10 1803 or later).
+    bool highResolution() const { return highRes; }
+
+private:
+    void sleepUntil(uint64_t when);
+
+    uint64_t deadline = 0; // EventClock::systemNow() domain
+    uint64_t spinTime = 0;
+    bool highRes = false;
+#ifdef _WIN32
+    HANDLE timer = NULL;
+#endif
+};
@@ -0,0 +1,306 @@
+#ifdef __linux__
+#include "UinputBackend.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/uinput.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include "HookStats.h"
+#include "Log.h"
+
+namespace
+{
+    struct VkMapping
+    {
+        uint8_t vkCode;
+        uint16_t key;
+    };
+
+    // Windows virtual-key code -> evdev key code, for a US layout.
+    const VkMapping VK_TO_EVDEV[] = {
+        {0x08, KEY_BACKSPACE}, {0x09, KEY_TAB}, {0x0D, KEY_ENTER}, {0x10, KEY_LEFTSHIFT},
+        {0x11, KEY_LEFTCTRL}, {0x12, KEY_LEFTALT}, {0x13, KEY_PAUSE}, {0x14, KEY_CAPSLOCK},
+        {0x1B, KEY_ESC}, {0x20, KEY_SPACE}, {0x21, KEY_PAGEUP}, {0x22, KEY_PAGEDOWN},
+        {0x23, KEY_END}, {0x24, KEY_HOME}, {0x25, KEY_LEFT}, {0x26, KEY_UP},
+        {0x27, KEY_RIGHT}, {0x28, KEY_DOWN}, {0x2C, KEY_SYSRQ}, {0x2D, KEY_INSERT},
+        {0x2E, KEY_DELETE},
+        {'0', KEY_0}, {'1', KEY_1}, {'2', KEY_2}, {'3', KEY_3}, {'4', KEY_4},
+        {'5', KEY_5}, {'6', KEY_6}, {'7', KEY_7}, {'8', KEY_8}, {'9', KEY_9},
+        {'A', KEY_A}, {'B', KEY_B}, {'C', KEY_C}, {'D', KEY_D}, {'E', KEY_E},
+        {'F', KEY_F}, {'G', KEY_G}, {'H', KEY_H}, {'I', KEY_I}, {'J', KEY_J},
+        {'K', KEY_K}, {'L', KEY_L}, {'M', KEY_M}, {'N', KEY_N}, {'O', KEY_O},
+        {'P', KEY_P}, {'Q', KEY_Q}, {'R', KEY_R}, {'S', KEY_S}, {'T', KEY_T},
+        {'U', KEY_U}, {'V', KEY_V}, {'W', KEY_W}, {'X', KEY_X}, {'Y', KEY_Y},
+        {'Z', KEY_Z},
+        {0x5B, KEY_LEFTMETA}, {0x5C, KEY_RIGHTMETA}, {0x5D, KEY_COMPOSE},
+        {0x60, KEY_KP0}, {0x61, KEY_KP1}, {0x62, KEY_KP2}, {0x63, KEY_KP3}, {0x64, KEY_KP4},
+        {0x65, KEY_KP5}, {0x66, KEY_KP6}, {0x67, KEY_KP7}, {0x68, KEY_KP8}, {0x69, KEY_KP9},
+        {0x6A, KEY_KPASTERISK}, {0x6B, KEY_KPPLUS}, {0x6D, KEY_KPMINUS}, {0x6E, KEY_KPDOT},
+        {0x6F, KEY_KPSLASH},
+        {0x70, KEY_F1}, {0x71, KEY_F2}, {0x72, KEY_F3}, {0x73, KEY_F4}, {0x74, KEY_F5},
+        {0x75, KEY_F6}, {0x76, KEY_F7}, {0x77, KEY_F8}, {0x78, KEY_F9}, {0x79, KEY_F10},
+        {0x7A, KEY_F11}, {0x7B, KEY_F12},
+        {0x90, KEY_NUMLOCK}, {0x91, KEY_SCROLLLOCK},
+        {0xA0, KEY_LEFTSHIFT}, {0xA1, KEY_RIGHTSHIFT}, {0xA2, KEY_LEFTCTRL}, {0xA3, KEY_RIGHTCTRL},
+        {0xA4, KEY_LEFTALT}, {0xA5, KEY_RIGHTALT},
+        {0xBA, KEY_SEMICOLON}, {0xBB, KEY_EQUAL}, {0xBC, KEY_COMMA}, {0xBD, KEY_MINUS},
+        {0xBE, KEY_DOT}, {0xBF, KEY_SLASH}, {0xC0, KEY_GRAVE}, {0xDB, KEY_LEFTBRACE},
+        {0xDC, KEY_BACKSLASH}, {0xDD, KEY_RIGHTBRACE}, {0xDE, KEY_APOSTROPHE},
+    };
+
+    struct EvdevTable
+    {
+        uint16_t keys[256] = {};
+
+        EvdevTable()
+        {
+            for (const VkMapping &mapping : VK_TO_EVDEV)
+            {
+                keys[mapping.vkCode] = mapping.key;
+            }
+        }
+    };
+
+    const EvdevTable evdevTable;
+
+    input_event makeEvent(uint16_t type, uint16_t code, int32_t value)
+    {
+        input_event event;
+        std::memset(&event, 0, sizeof(event)); // the kernel stamps the time
+        event.type = type;
+        event.code = code;
+        event.value = value;
+        return event;
+    }
+}
+
+int UinputBackend::evdevKey(int vkCode)
+{
+    return evdevTable.keys[vkCode & 0xFF];
+}
+
+void UinputBackend::resetCursor(int desktopWidth, int desktopHeight)
+{
+    width = desktopWidth;
+    height = desktopHeight;
+    cursorX = width / 2;
+    cursorY = height / 2;
+}
+
+bool UinputBackend::open(int desktopWidth, int desktopHeight)
+{
+    close();
+    resetCursor(desktopWidth, desktopHeight);
+    if (!createDevice(RELATIVE_DEVICE) || !createDevice(ABSOLUTE_DEVICE))
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void UinputBackend::attach(int relativeFd, int absoluteFd, int desktopWidth, int desktopHeight)
+{
+    close();
+    resetCursor(desktopWidth, desktopHeight);
+    fds[RELATIVE_DEVICE] = relativeFd;
+    fds[ABSOLUTE_DEVICE] = absoluteFd;
+}
+
+bool UinputBackend::createDevice(Device device)
+{
+    const int fd = ::open("/dev/uinput", O_WRONLY | O_NONBLOCK);
+    if (fd < 0)
+    {
+        LOG_ERROR("uinput: cannot open /dev/uinput (errno {})", errno);
+        return false;
+    }
+    fds[device] = fd;
+    ioctl(fd, UI_SET_EVBIT, EV_KEY);
+    ioctl(fd, UI_SET_KEYBIT, BTN_LEFT);
+    ioctl(fd, UI_SET_KEYBIT, BTN_RIGHT);
+    ioctl(fd, UI_SET_KEYBIT, BTN_MIDDLE);
+    uinput_setup setup;
+    std::memset(&setup, 0, sizeof(setup));
+    setup.id.bustype = BUS_VIRTUAL;
+    setup.id.vendor = 0x4E4B; // "NK"
+    if (device == RELATIVE_DEVICE)
+    {
+        for (const VkMapping &mapping : VK_TO_EVDEV)
+        {
+            ioctl(fd, UI_SET_KEYBIT, mapping.key);
+        }
+        ioctl(fd, UI_SET_EVBIT, EV_REL);
+        ioctl(fd, UI_SET_RELBIT, REL_X);
+        ioctl(fd, UI_SET_RELBIT, REL_Y);
+        ioctl(fd, UI_SET_RELBIT, REL_WHEEL);
+        ioctl(fd, UI_SET_RELBIT, REL_HWHEEL);
+        ioctl(fd, UI_SET_RELBIT, REL_WHEEL_HI_RES);
+        ioctl(fd, UI_SET_RELBIT, REL_HWHEEL_HI_RES);
+        setup.id.product = 0x0001;
+        std::strncpy(setup.name, "NiftyKeys virtual keyboard and mouse", UINPUT_MAX_NAME_SIZE - 1);
+    }
+    else
+    {
+        ioctl(fd, UI_SET_EVBIT, EV_ABS);
+        ioctl(fd, UI_SET_ABSBIT, ABS_X);
+        ioctl(fd, UI_SET_ABSBIT, ABS_Y);
+        ioctl(fd, UI_SET_PROPBIT, INPUT_PROP_POINTER);
+        uinput_abs_setup abs;
+        std::memset(&abs, 0, sizeof(abs));
+        abs.code = ABS_X;
+        abs.absinfo.maximum = width > 1 ? width - 1 : 1;
+        ioctl(fd, UI_ABS_SETUP, &abs);
+        abs.code = ABS_Y;
+        abs.absinfo.maximum = height > 1 ? height - 1 : 1;
+        ioctl(fd, UI_ABS_SETUP, &abs);
+        setup.id.product = 0x0002;
+        std::strncpy(setup.name, "NiftyKeys virtual pointer", UINPUT_MAX_NAME_SIZE - 1);
+    }
+    if (ioctl(fd, UI_DEV_SETUP, &setup) < 0 || ioctl(fd, UI_DEV_CREATE) < 0)
+    {
+        LOG_ERROR("uinput: cannot create the device (errno {})", errno);
+        return false;
+    }
+    return true;
+}
+
+void UinputBackend::close()
+{
+    for (int &fd : fds)
+    {
+        if (fd >= 0)
+        {
+            ioctl(fd, UI_DEV_DESTROY);
+            ::close(fd);
+            fd = -1;
+        }
+    }
+}
+
+bool UinputBackend::cursorPosition(int &x, int &y)
+{
+    if (!isOpen())
+    {
+        return false;
+    }
+    x = cursorX;
+    y = cursorY;
+    return true;
+}
+
+size_t UinputBackend::translate(const OutputEvent &event, input_event *out)
+{
+    size_t n = 0;
+    switch (event.kind)
+    {
+    case OutputKind::KeyDown:
+    case OutputKind::KeyUp:
+    {
+        const int key = evdevKey(event.vkCode);
+        if (key == 0)
+        {
+            return 0;
+        }
+        out[n++] = makeEvent(EV_KEY, static_cast<uint16_t>(key), event.kind == OutputKind::KeyDown ? 1 : 0);
+        break;
+    }
+    case OutputKind::MouseMove:
+        cursorX = std::min(std::max(cursorX + event.dx, 0), width - 1);
+        cursorY = std::min(std::max(cursorY + event.dy, 0), height - 1);
+        if (event.dx != 0)
+            out[n++] = makeEvent(EV_REL, REL_X, event.dx);
+        if (event.dy != 0)
+            out[n++] = makeEvent(EV_REL, REL_Y, event.dy);
+        break;
+    case OutputKind::MouseMoveTo:
+        cursorX = event.dx;
+        cursorY = event.dy;
+        out[n++] = makeEvent(EV_ABS, ABS_X, event.dx);
+        out[n++] = makeEvent(EV_ABS, ABS_Y, event.dy);
+        break;
+    case OutputKind::ButtonDown:
+    case OutputKind::ButtonUp:
+    {
+        const uint16_t button = event.button == MOUSE_LEFT ? BTN_LEFT : event.button == MOUSE_RIGHT ? BTN_RIGHT
+                                                                                                    : BTN_MIDDLE;
+        out[n++] = makeEvent(EV_KEY, button, event.kind == OutputKind::ButtonDown ? 1 : 0);
+        break;
+    }
+    case OutputKind::Wheel:
+    {
+        // Hi-res events carry the exact travel (120 per notch, as on Windows); clients
+        // that only understand REL_WHEEL get one event per completed notch.
+        const int32_t travel[2] = {event.dy, event.dx};
+        const uint16_t hiRes[2] = {REL_WHEEL_HI_RES, REL_HWHEEL_HI_RES};
+        const uint16_t notch[2] = {REL_WHEEL, REL_HWHEEL};
+        for (int axis = 0; axis < 2; axis++)
+        {
+            if (travel[axis] == 0)
+                continue;
+            out[n++] = makeEvent(EV_REL, hiRes[axis], travel[axis]);
+            wheelRemainder[axis] += travel[axis];
+            const int notches = wheelRemainder[axis] / 120;
+            if (notches != 0)
+            {
+                out[n++] = makeEvent(EV_REL, notch[axis], notches);
+                wheelRemainder[axis] -= notches * 120;
+            }
+        }
+        break;
+    }
+    }
+    if (n > 0)
+    {
+        out[n++] = makeEvent(EV_SYN, SYN_REPORT, 0);
+    }
+    return n;
+}
+
+UinputBackend::Device UinputBackend::deviceFor(const OutputEvent &event)
+{
+    return event.kind == OutputKind::MouseMoveTo ? ABSOLUTE_DEVICE : RELATIVE_DEVICE;
+}
+
+void UinputBackend::submit(const OutputEvent *events, size_t count)
+{
+    if (!isOpen())
+    {
+        return;
+    }
+    input_event buffer[MAX_EVENTS];
+    size_t used = 0;
+    Device current = RELATIVE_DEVICE;
+    for (size_t i = 0; i < count; i++)
+    {
+        const Device device = deviceFor(events[i]);
+        if (used > 0 && (device != current || used + MAX_EVENTS_PER_OUTPUT > MAX_EVENTS))
+        {
+            write(current, buffer, used);
+            used = 0;
+        }
+        current = device;
+        used += translate(events[i], buffer + used);
+    }
+    write(current, buffer, used);
+}
+
+void UinputBackend::write(Device device, const input_event *events, size_t count)
+{
+    if (count == 0)
+    {
+        return;
+    }
+    uint64_t start = HookStats::now();
+    const ssize_t result = ::write(fds[device], events, count * sizeof(input_event));
+    HookStats::record(HookStats::SEND_INPUT, start, HookStats::now());
+    writes++;
+    written += count;
+    if (result != static_cast<ssize_t>(count * sizeof(input_event)))
+    {
+        LOG_WARN("uinput: short write ({} of {} events, errno {})", static_cast<long long>(result < 0 ? 0 : result / sizeof(input_event)), count, errno);
+    }
+}
+#endif
@@ -0,0 +1,72 @@
+#pragma once
+#ifdef __linux__
+#include <linux/input.h>
+#include "OutputBackend.h"
+
+// The Linux backend: virtual input devices created through /dev/uinput.
+//
+// There are two devices, because desktops classify a device by what it advertises and one
+// that reports both EV_REL and EV_ABS is treated as neither a mouse nor a tablet: a
+// relative one (the keyboard, mouse buttons, REL_X/REL_Y and the wheels) and an absolute
+// pointer (ABS_X/ABS_Y over the desktop, plus buttons so it counts as a pointer). Each
+// batch is translated into input_events (with a SYN_REPORT closing every key, button,
+// motion or wheel event), and every run of consecutive events for the same device goes to
+// the kernel in a single write(), so order is kept across the two. Key events carry
+// Windows virtual-key codes, which are mapped to evdev KEY_* codes here.
+//
+// Absolute motion uses an ABS_X/ABS_Y range of 0..width-1 / 0..height-1, so coordinates
+// are desktop pixels just as on Windows.
+class UinputBackend : public OutputBackend
+{
+public:
+    enum Device
+    {
+        RELATIVE_DEVICE,
+        ABSOLUTE_DEVICE,
+        DEVICE_COUNT,
+    };
+
+    ~UinputBackend() { close(); }
+
+    // Create the devices. Returns false (and logs why) if /dev/uinput is unavailable.
+    bool open(int desktopWidth, int desktopHeight);
+    // Write to already open descriptors instead of creating devices (benchmarks pass
+    // /dev/null). The backend closes them.
+    void attach(int relativeFd, int absoluteFd, int desktopWidth, int desktopHeight);
+    void close();
+    bool isOpen() const { return fds[RELATIVE_DEVICE] >= 0; }
+
+    void submit(const OutputEvent *events, size_t count) override;
+    // uinput cannot read the pointer back; this is where our own output has put it,
+    // starting from the middle of the desktop.
+    bool cursorPosition(int &x, int &y) override;
+
+    // write() calls made and input_events written, for benchmarks.
+    uint64_t writeCount() const { return writes; }
+    uint64_t inputEventCount() const { return written; }
+
+    // evdev key code for a virtual-key code, or 0 if there is none.
+    static int evdevKey(int vkCode);
+
+private:
+    static constexpr size_t MAX_EVENTS = 256;
+    static constexpr size_t MAX_EVENTS_PER_OUTPUT = 5; // wheel: two hi-res + two notch + SYN
+
+    bool createDevice(Device device);
+    void resetCursor(int desktopWidth, int desktopHeight);
+    // Which device 'event' goes to.
+    static Device deviceFor(const OutputEvent &event);
+    size_t translate(const OutputEvent &event, input_event *out);
+    void write(Device device, const input_event *events, size_t count);
+
+    int fds[DEVICE_COUNT] = {-1, -1};
+    int width = 0;
+    int height = 0;
+    int cursorX = 0;
+    int cursorY = 0;
+    // Hi-res wheel travel not yet reported as a whole notch, per axis (0 = vertical).
+    int wheelRemainder[2] = {0, 0};
+    uint64_t writes = 0;
+    uint64_t written = 0;
+};
+#endif
@@ -0,0 +1,38 @@
+#include "WakeSignal.h"
+#include <chrono>
+
+void WakeSignal::notify()
+{
+    signalled.store(true, std::memory_order_seq_cst);
+    // Pairs with the store to 'parked' in wait(): either we see it parked, or it sees
+    // 'signalled' before it goes to sleep.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (parked.load(std::memory_order_seq_cst))
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        wakeup.notify_one();
+    }
+}
+
+bool WakeSignal::wait(uint64_t timeout)
+{
+    if (consume())
+    {
+        return true;
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    parked.store(true, std::memory_order_seq_cst);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto notified = [this]
+    { return signalled.load(std::memory_order_seq_cst); };
+    if (timeout == FOREVER)
+    {
+        wakeup.wait(lock, notified);
+    }
+    else
+    {
+        wakeup.wait_for(lock, std::chrono::nanoseconds(timeout), notified);
+    }
+    parked.store(false, std::memory_order_relaxed);
+    return consume();
+}
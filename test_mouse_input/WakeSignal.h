@@ -0,0 +1,28 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+// Lets a thread sleep until there is something for it to do.
+//
+// notify() can be called from any thread and is cheap when nobody is waiting: it takes the
+// mutex only if it sees the waiter parked (same handshake as InjectionQueue). A notify()
+// that arrives while the waiter is awake is remembered, so the next wait() returns at once.
+class WakeSignal
+{
+public:
+    static constexpr uint64_t FOREVER = UINT64_MAX;
+
+    void notify();
+    // Block until notify() or until 'timeout' ns have passed. Returns true if notified.
+    bool wait(uint64_t timeout = FOREVER);
+    // Take a pending notify() without blocking (replay, where nothing can wake us).
+    bool consume() { return signalled.exchange(false, std::memory_order_acq_rel); }
+
+private:
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    std::atomic<bool> signalled{false};
+    std::atomic<bool> parked{false};
+};
@@ -6,17 +6,34 @@
 #include <unordered_map>
 #include <thread>
 #include <chrono>
-#include <mutex>
 #include <cmath>
 #include "ModeManager.h"
 #include "KeyState.h"
 #include "InputSimulator.h"
+#include "SendInputBackend.h"
+#include "InjectionQueue.h"
+#include "HookCapture.h"
+#include "HookStats.h"
+#include "HookWatchdog.h"
+#include "Log.h"
+#include "AllocationGuard.h"
+#include "KeyEngine.h"
+#include "Replay.h"
+#include "DisplayGeometry.h"
+#include "TickScheduler.h"
+#include "TapHistory.h"
 // ---------------------------------------------
 // Configuration Loading (Optional)
 struct Config
 {
     int click_count;
     int interval_ms;
+    // Time budget for one hook callback; keep this below the system's LowLevelHooksTimeout.
+    int hook_budget_ms = 300;
+    // Busy-wait this long before each motion tick for tighter timing (see TickScheduler).
+    int tick_spin_us = 0;
+    // Presses of the same key closer together than this count as a double/triple tap.
+    int tap_window_ms = static_cast<int>(TapHistory::DEFAULT_WINDOW / EventClock::MILLISECOND);
 };
 
 bool loadConfig(const std::string &filename, Config &config)
@@ -33,6 +50,9 @@ bool loadConfig(const std::string &filename, Config &config)
         file >> jsonConfig;
         config.click_count = jsonConfig.at("click_count").get<int>();
         config.interval_ms = jsonConfig.at("interval_ms").get<int>();
+        config.hook_budget_ms = jsonConfig.value("hook_budget_ms", config.hook_budget_ms);
+        config.tick_spin_us = jsonConfig.value("tick_spin_us", config.tick_spin_us);
+        config.tap_window_ms = jsonConfig.value("tap_window_ms", config.tap_window_ms);
     }
     catch (const std::exception &e)
     {
@@ -40,42 +60,83 @@ bool loadConfig(const std::string &filename, Config &config)
         return false;
     }
     std::cout << "Configuration loaded: click_count = " << config.click_count
-              << ", interval_ms = " << config.interval_ms << std::endl;
+              << ", interval_ms = " << config.interval_ms
+              << ", hook_budget_ms = " << config.hook_budget_ms
+              << ", tick_spin_us = " << config.tick_spin_us
+              << ", tap_window_ms = " << config.tap_window_ms << std::endl;
     return true;
 }
 
-void updateKeyState(int vkCode, bool isDown)
+// tick_spin_us in ns, capped for the shortest tick of any loaded mode (see
+// TickScheduler::spinFor) with a warning if the configured spin was longer.
+uint64_t tickSpinTime(const Config &config)
 {
-    std::lock_guard<std::mutex> lock(keyStatesMutex);
-    if (isDown)
+    const uint64_t spin = static_cast<uint64_t>(std::max(config.tick_spin_us, 0)) * EventClock::MICROSECOND;
+    const uint64_t shortestTick = Mode::shortestTickInterval();
+    const uint64_t capped = TickScheduler::spinFor(spin, shortestTick);
+    if (capped < spin)
     {
-        if (keyStates.find(vkCode) == keyStates.end() || !keyStates[vkCode].held)
-        {
-            keyStates[vkCode].held = true;
-            keyStates[vkCode].timePressed = GetTickCount64();
-            keyStates[vkCode].timeReleased = 0;
-        }
+        std::cerr << "tick_spin_us = " << config.tick_spin_us << " would spin through whole "
+                  << shortestTick / EventClock::MICROSECOND << " us ticks; spinning "
+                  << capped / EventClock::MICROSECOND << " us instead" << std::endl;
     }
-    else
+    return capped;
+}
+
+bool running = true;
+void pollingThread(uint64_t spin)
+{
+    TickScheduler scheduler;
+    scheduler.setSpin(spin);
+    if (!scheduler.highResolution())
     {
-        if (keyStates.find(vkCode) != keyStates.end())
+        LOG_WARN("No high-resolution timer; motion ticks follow the system timer");
+    }
+    while (running)
+    {
+        const uint64_t interval = KeyEngine::tick();
+        if (interval == KeyEngine::NO_TICK)
+        {
+            // Nothing moves: sleep with no timeout until a motion key or shutdown.
+            KeyEngine::tickWake.wait();
+            scheduler.restart();
+        }
+        else
         {
-            keyStates[vkCode].held = false;
-            keyStates[vkCode].timeReleased = GetTickCount64();
+            scheduler.waitNext(interval);
         }
+        KeyEngine::countWakeup();
     }
 }
 
-bool running = true;
-void pollingThread()
+// ---------------------------------------------
+// Engine Thread
+//
+// Runs the mode pipeline (KeyEngine::processKeyEvent) for every event the hook captured,
+// in order, so none of that work counts against the hook's time budget.
+HANDLE engineWakeEvent = NULL;
+
+void engineThread()
 {
+    KeyEvent event;
     while (running)
     {
-        if (Mode::currentMode != nullptr)
+        // Every captured event (and shutdown) signals the wake event; otherwise sleep until
+        // the next key repeat, or indefinitely.
+        DWORD timeoutMs = INFINITE;
+        const uint64_t due = Mode::repeater.nextDue();
+        if (due != KeyRepeater::NEVER)
         {
-            Mode::currentMode->Update();
+            const uint64_t now = EventClock::now();
+            timeoutMs = due > now ? static_cast<DWORD>((due - now + EventClock::MILLISECOND - 1) / EventClock::MILLISECOND) : 0;
         }
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        WaitForSingleObject(engineWakeEvent, timeoutMs);
+        KeyEngine::countWakeup();
+        while (HookCapture::ring.pop(event))
+        {
+            KeyEngine::processKeyEvent(event);
+        }
+        KeyEngine::fireRepeats();
     }
 }
 
@@ -83,45 +144,58 @@ void pollingThread()
 // Low-level Keyboard Hook Procedure
 //
 // While SPACE is held (space mode), movement keys (WASD, JKL;) and mouse button keys
-// (Q = Left, E = Right, H = Middle) are intercepted. For each movement key, if a rapid re-press
-// is detected (by comparing the current press time to the last release), the corresponding leap boolean
-// is set.
+// (Q = Left, E = Right, H = Middle) are intercepted. Rapid re-presses of a movement key leap the
+// cursor (see SpaceMode::leap).
+//
+// The hook itself only captures: HookCapture decides consume-or-pass from its precomputed
+// verdict tables and queues the event for the engine thread, which does the actual work.
 HHOOK hHook = NULL;
+HookWatchdog hookWatchdog;
 LRESULT CALLBACK LowLevelKeyboardProc(int nCode, WPARAM wParam, LPARAM lParam)
 {
     if (nCode == HC_ACTION)
     {
-        bool handled = false;
         KBDLLHOOKSTRUCT *pKeyboard = reinterpret_cast<KBDLLHOOKSTRUCT *>(lParam);
-        int vkCode = pKeyboard->vkCode;
-        DWORD now = GetTickCount64();
+        // Our own SendInput output comes back through here; it must not drive the modes again.
+        if (HookCapture::isSelfInjected(*pKeyboard))
+        {
+            hookWatchdog.onHeartbeat(HookStats::now());
+            return CallNextHookEx(hHook, nCode, wParam, lParam);
+        }
+        AllocationGuard::Scope hotPath;
+        uint64_t start = HookStats::now();
 
         // In the low-level keyboard hook procedure, the return value determines whether the event is consumed:
         // Returning 1 indicates that the key event has been handled (for example, a mode action was taken)
         // and should not be propagated further to other hooks or the system.
         // Returning 0 (or calling CallNextHookEx) means the event was not handled, so it should be passed on
         // for normal processing.
-        // Here, SPACE (or any activation key) is used to activate a mode:
-        // If a mode is already active, only the release of that key is processed;
-        // Otherwise, activation keys are checked to set the current mode.
+        bool isDown = (wParam == WM_KEYDOWN || wParam == WM_SYSKEYDOWN);
+        // Autorepeats never reach the engine (it makes its own, see KeyRepeater).
+        bool consumeRepeat = false;
+        if (HookCapture::filterRepeat(*pKeyboard, isDown, consumeRepeat))
+        {
+            // Raw input reports repeats to the watchdog too, so they must count as heartbeats.
+            hookWatchdog.onHeartbeat(start);
+            return consumeRepeat ? 1 : CallNextHookEx(hHook, nCode, wParam, lParam);
+        }
+        bool handled = HookCapture::capture(*pKeyboard, isDown);
+        SetEvent(engineWakeEvent);
+        uint64_t end = HookStats::now();
+        HookStats::record(HookStats::HOOK_CALLBACK, start, end);
 
-           if (wParam == WM_KEYDOWN || wParam == WM_SYSKEYDOWN)
+        // The system's timeout runs from when it generated the event, not from when we got
+        // to it, so charge the watchdog with whichever of the two is longer.
+        // Injected events can carry odd timestamps, so ignore anything implausibly old.
+        uint64_t elapsed = end - start;
+        DWORD sinceEventMs = GetTickCount() - pKeyboard->time;
+        if (sinceEventMs < 60000 && sinceEventMs * 1000000ull > elapsed)
         {
-            handled = Mode::checkIfActivatesMode(vkCode);
-            if (!handled && Mode::currentMode != nullptr)
-            {
-                handled = Mode::currentMode->handleKeyDownEvent(vkCode);
-            }
-            updateKeyState(vkCode, true);
+            elapsed = sinceEventMs * 1000000ull;
         }
-        else if (wParam == WM_KEYUP || wParam == WM_SYSKEYUP)
+        if (hookWatchdog.onCallback(end, elapsed))
         {
-            handled = Mode::checkActiveModeEnded(vkCode);
-            if (!handled && Mode::currentMode != nullptr)
-            {
-         handled = Mode::currentMode->handleKeyUpEvent(vkCode);
-            }
-            updateKeyState(vkCode, false);
+            HookCapture::degradeActiveMode();
         }
         if (!handled)
         {
@@ -136,10 +210,147 @@ LRESULT CALLBACK LowLevelKeyboardProc(int nCode, WPARAM wParam, LPARAM lParam)
     return 0;
 }
 
+// ---------------------------------------------
+// Hook Watchdog Window
+//
+// A message-only window on the hook's own thread. It receives raw keyboard input, which
+// Windows delivers whether or not our hook is still installed, and a timer that polls the
+// watchdog. Re-installing has to happen here because a hook belongs to the thread that set it.
+const UINT_PTR WATCHDOG_TIMER_ID = 1;
+const UINT WATCHDOG_POLL_MS = 250;
+
+bool installHook()
+{
+    hHook = SetWindowsHookEx(WH_KEYBOARD_LL, LowLevelKeyboardProc, NULL, 0);
+    if (hHook != NULL)
+    {
+        hookWatchdog.onHookInstalled(HookStats::now());
+    }
+    return hHook != NULL;
+}
+
+LRESULT CALLBACK watchdogWndProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam)
+{
+    if (message == WM_INPUT)
+    {
+        hookWatchdog.onObservedInput(HookStats::now());
+    }
+    else if (message == WM_TIMER && wParam == WATCHDOG_TIMER_ID)
+    {
+        switch (hookWatchdog.poll(HookStats::now()))
+        {
+        case HookWatchdog::REINSTALL_HOOK:
+            std::cerr << "Keyboard hook stopped receiving input; re-installing it." << std::endl;
+            UnhookWindowsHookEx(hHook);
+            if (!installHook())
+            {
+                std::cerr << "Failed to re-install keyboard hook." << std::endl;
+            }
+            break;
+        case HookWatchdog::RESTORE_MODES:
+            for (Mode *mode : Mode::modes)
+            {
+                mode->degraded = false;
+            }
+            break;
+        default:
+            break;
+        }
+        return 0;
+    }
+    return DefWindowProcW(hwnd, message, wParam, lParam);
+}
+
+HWND createWatchdogWindow()
+{
+    WNDCLASSEXW windowClass = {};
+    windowClass.cbSize = sizeof(windowClass);
+    windowClass.lpfnWndProc = watchdogWndProc;
+    windowClass.hInstance = GetModuleHandleW(NULL);
+    windowClass.lpszClassName = L"NiftyKeysHookWatchdog";
+    RegisterClassExW(&windowClass);
+    HWND hwnd = CreateWindowExW(0, windowClass.lpszClassName, L"", 0, 0, 0, 0, 0, HWND_MESSAGE, NULL, windowClass.hInstance, NULL);
+    if (hwnd == NULL)
+    {
+        return NULL;
+    }
+    // Generic desktop keyboard, delivered even though the window never has focus.
+    RAWINPUTDEVICE keyboard = {};
+    keyboard.usUsagePage = 0x01;
+    keyboard.usUsage = 0x06;
+    keyboard.dwFlags = RIDEV_INPUTSINK;
+    keyboard.hwndTarget = hwnd;
+    if (!RegisterRawInputDevices(&keyboard, 1, sizeof(keyboard)))
+    {
+        std::cerr << "Failed to register raw keyboard input; hook liveness checks disabled." << std::endl;
+    }
+    SetTimer(hwnd, WATCHDOG_TIMER_ID, WATCHDOG_POLL_MS, NULL);
+    return hwnd;
+}
+
+// ---------------------------------------------
+// Display Window
+//
+// WM_DISPLAYCHANGE and WM_SETTINGCHANGE are only broadcast to top-level windows, so the
+// message-only watchdog window never sees them; this hidden one exists to catch them and
+// re-read the monitor layout.
+LRESULT CALLBACK displayWndProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam)
+{
+    if (message == WM_DISPLAYCHANGE || message == WM_DPICHANGED || (message == WM_SETTINGCHANGE && wParam == SPI_SETWORKAREA))
+    {
+        DisplayGeometry::refreshFromSystem();
+        return 0;
+    }
+    return DefWindowProcW(hwnd, message, wParam, lParam);
+}
+
+HWND createDisplayWindow()
+{
+    WNDCLASSEXW windowClass = {};
+    windowClass.cbSize = sizeof(windowClass);
+    windowClass.lpfnWndProc = displayWndProc;
+    windowClass.hInstance = GetModuleHandleW(NULL);
+    windowClass.lpszClassName = L"NiftyKeysDisplayWatcher";
+    RegisterClassExW(&windowClass);
+    // Never shown; WS_EX_TOOLWINDOW keeps it out of the taskbar and Alt+Tab.
+    return CreateWindowExW(WS_EX_TOOLWINDOW, windowClass.lpszClassName, L"", WS_POPUP, 0, 0, 0, 0, NULL, NULL, windowClass.hInstance, NULL);
+}
+
+uint64_t startTime = 0;
+InjectionQueue injectionQueue;
+
+// Ctrl+Break prints the stage latency report without stopping the app.
+BOOL WINAPI consoleCtrlHandler(DWORD ctrlType)
+{
+    if (ctrlType == CTRL_BREAK_EVENT)
+    {
+        HookStats::report(std::cout);
+        InjectionBatcher::report(std::cout, EventClock::now() - startTime);
+        injectionQueue.report(std::cout);
+        KeyEngine::report(std::cout, startTime);
+        return TRUE;
+    }
+    return FALSE;
+}
+
 // ---------------------------------------------
 // Main Function
-int main()
+int main(int argc, char *argv[])
 {
+    // "--replay <script> ..." runs the modes headless instead of hooking the keyboard.
+    if (argc > 1)
+    {
+        return Replay::runFromArguments(argc, argv);
+    }
+    Log::start();
+    startTime = EventClock::now();
+    // Physical pixels everywhere, so monitor rectangles, DPI and the cursor agree.
+    SetProcessDpiAwarenessContext(DPI_AWARENESS_CONTEXT_PER_MONITOR_AWARE_V2);
+    DisplayGeometry::refreshFromSystem();
+    // Batches flow batcher -> injection queue -> injector thread -> SendInput.
+    static SendInputBackend sendInput;
+    injectionQueue.start(&sendInput);
+    InjectionBatcher::setBackend(&injectionQueue);
     Mode::loadModes("modes.json");
     Config config;
     const std::string configFile = "config.json";
@@ -147,21 +358,38 @@ int main()
     {
         std::cerr << "Error loading configuration. Continuing without config parameters." << std::endl;
     }
-    hHook = SetWindowsHookEx(WH_KEYBOARD_LL, LowLevelKeyboardProc, NULL, 0);
-    if (hHook == NULL)
+    HookWatchdog::Settings watchdogSettings;
+    watchdogSettings.budget = static_cast<uint64_t>(config.hook_budget_ms) * 1000000ull;
+    hookWatchdog.configure(watchdogSettings);
+    keyTaps.setWindow(static_cast<uint64_t>(config.tap_window_ms) * EventClock::MILLISECOND);
+    engineWakeEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+    std::thread engine(engineThread);
+    if (!installHook())
     {
         std::cerr << "Failed to install keyboard hook." << std::endl;
+        running = false;
+        SetEvent(engineWakeEvent);
+        engine.join();
+        injectionQueue.stop();
+        Log::stop();
         return 1;
     }
-    std::thread poller(pollingThread);
+    HWND watchdogWindow = createWatchdogWindow();
+    HWND displayWindow = createDisplayWindow();
+    std::thread poller(pollingThread, tickSpinTime(config));
+    SetConsoleCtrlHandler(consoleCtrlHandler, TRUE);
     std::cout << "MouseKeys app running in space mode:" << std::endl;
     std::cout << "Movement keys (while SPACE held):" << std::endl;
     std::cout << "  WASD and JKL; control movement with acceleration." << std::endl;
-    std::cout << "    (Rapid re-press of a direction key causes a leap/jump half-way to that screen edge)" << std::endl;
+    std::cout << "    (Double-tap a direction key to leap half-way to that edge of the monitor;" << std::endl;
+    std::cout << "     each further tap leaps half as far again, either way)" << std::endl;
     std::cout << "Mouse buttons (while SPACE held):" << std::endl;
     std::cout << "  Q = Left, E = Right, H = Middle (separate down/up events)" << std::endl;
+    std::cout << "Scrolling (while SPACE held):" << std::endl;
+    std::cout << "  R = Up, F = Down, Z = Left, X = Right (smooth, high-resolution)" << std::endl;
     std::cout << "A quick tap of SPACE sends a normal SPACE." << std::endl;
     std::cout << "Press ESC to exit." << std::endl;
+    std::cout << "Press Ctrl+Break to print hook latency statistics." << std::endl;
     MSG msg;
     // Passing &msg to GetMessage is correct because GetMessage expects a pointer to a MSG structure.
     // However, pay attention to the declaration of msg above:
@@ -174,6 +402,7 @@ int main()
         DispatchMessage(&msg);
     }
     running = false;
+    KeyEngine::tickWake.notify();
     // The red underline on "poller" in "poller.join()" is typically an IDE warning rather than a compilation error.
     // It often appears when the IDE’s static analyzer suspects that the std::thread object might not be joinable.
     // This can happen if:
@@ -184,10 +413,52 @@ int main()
     // to ensure the pollingThread eventually exits, making the thread joinable when we call join().
     // Thus, the red underline is most likely a false positive from the IDE’s static analysis.
     poller.join();
+    if (watchdogWindow != NULL)
+    {
+        KillTimer(watchdogWindow, WATCHDOG_TIMER_ID);
+        DestroyWindow(watchdogWindow);
+    }
+    if (displayWindow != NULL)
+    {
+        DestroyWindow(displayWindow);
+    }
     if (hHook)
     {
         UnhookWindowsHookEx(hHook);
         hHook = NULL;
     }
+    SetEvent(engineWakeEvent);
+    engine.join();
+    CloseHandle(engineWakeEvent);
+    // Nothing produces input any more; let the injector send what is left.
+    injectionQueue.stop();
+    Log::stop();
+    std::cout << "Logger: formatter woke " << Log::wakeupCount() << " times";
+    if (Log::droppedCount() > 0)
+    {
+        std::cout << ", dropped " << Log::droppedCount() << " records";
+    }
+    std::cout << std::endl;
+    std::cout << "Event ring: high-water mark " << HookCapture::ring.highWaterMark()
+              << " of " << HookCapture::ring.capacity()
+              << ", overflows " << HookCapture::ring.overflowCount()
+              << ", self-injected events passed through " << HookCapture::selfInjectedCount.load()
+              << ", autorepeats dropped " << HookCapture::repeatCount.load()
+              << ", repeats generated " << Mode::repeater.repeatCount() << std::endl;
+    std::cout << "Hook watchdog: degraded " << hookWatchdog.getDegradeCount()
+              << " times, re-installed the hook " << hookWatchdog.getReinstallCount() << " times" << std::endl;
+    if (AllocationGuard::enabled())
+    {
+        std::cout << "Hot-path heap allocations: " << AllocationGuard::hotPathAllocations();
+        if (AllocationGuard::hotPathAllocations() > 0)
+        {
+            std::cout << " (last one " << AllocationGuard::lastViolationSize() << " bytes)";
+        }
+        std::cout << std::endl;
+    }
+    InjectionBatcher::report(std::cout, EventClock::now() - startTime);
+    injectionQueue.report(std::cout);
+    KeyEngine::report(std::cout, startTime);
+    HookStats::report(std::cout);
     return 0;
 }
@@ -0,0 +1,72 @@
+#pragma once
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include "EventClock.h"
+
+// Just enough for the Linux test programs. Each test is its own executable: CHECK records a
+// failure and carries on, and main() returns test::result(), so ctest sees a non-zero exit
+// if anything failed. Benchmarks use the same checks for their sanity limits.
+namespace test
+{
+    inline int &failures()
+    {
+        static int count = 0;
+        return count;
+    }
+
+    inline int result()
+    {
+        if (failures() > 0)
+        {
+            std::cerr << failures() << " check(s) failed" << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    // A benchmark's iteration count: its first argument, or 'fallback'.
+    inline uint64_t iterations(int argc, char *argv[], uint64_t fallback)
+    {
+        return argc > 1 ? std::strtoull(argv[1], nullptr, 10) : fallback;
+    }
+
+    // Wall-clock time of 'body', in ns.
+    template <typename F>
+    uint64_t timeIt(F body)
+    {
+        const uint64_t start = EventClock::systemNow();
+        body();
+        return EventClock::systemNow() - start;
+    }
+
+    inline void report(const std::string &what, uint64_t elapsed, uint64_t count)
+    {
+        std::cout << what << ": " << count << " in " << elapsed / 1e6 << " ms, "
+                  << static_cast<double>(elapsed) / static_cast<double>(count ? count : 1) << " ns each" << std::endl;
+    }
+}
+
+#define CHECK(condition)                                                                         \
+    do                                                                                           \
+    {                                                                                            \
+        if (!(condition))                                                                        \
+        {                                                                                        \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #condition ") failed" << std::endl; \
+            test::failures()++;                                                                  \
+        }                                                                                        \
+    } while (0)
+
+#define CHECK_EQ(actual, expected)                                                               \
+    do                                                                                           \
+    {                                                                                            \
+        const auto &actualValue = (actual);                                                      \
+        const auto &expectedValue = (expected);                                                  \
+        if (!(actualValue == expectedValue))                                                     \
+        {                                                                                        \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": " #actual " is " << actualValue         \
+                      << ", expected " << expectedValue << std::endl;                            \
+            test::failures()++;                                                                  \
+        }                                                                                        \
+    } while (0)
@@ -0,0 +1,113 @@
+// Cost of one key event through capture and the engine with 1, 10 and 100 modes loaded.
+// Activation and key lookups are single table loads, so the per-event cost should not
+// grow with the number of modes.
+// Usage: bench_dispatch [rounds]
+#include <vector>
+#include "TestSupport.h"
+#include "HookCapture.h"
+#include "InjectionBatcher.h"
+#include "KeyEngine.h"
+#include "ModeManager.h"
+
+namespace
+{
+    class NullBackend : public OutputBackend
+    {
+    public:
+        uint64_t events = 0;
+        void submit(const OutputEvent *, size_t count) override { events += count; }
+    };
+
+    const char MAPPED[] = "QWERTYUIOP";
+    // Left Windows key: mapped by no mode and activates none.
+    const int UNMAPPED = 0x5B;
+
+    // Virtual-key codes to activate modes with: anything but the mapped keys.
+    std::vector<int> activationKeys()
+    {
+        std::vector<int> keys;
+        for (int vk = 0x21; vk < 0xDF && keys.size() < 100; vk++)
+        {
+            bool mapped = false;
+            for (const char *c = MAPPED; *c; c++)
+            {
+                mapped = mapped || vk == *c;
+            }
+            if (!mapped && vk != UNMAPPED)
+            {
+                keys.push_back(vk);
+            }
+        }
+        return keys;
+    }
+
+    uint64_t captured = 0;
+
+    void key(int vkCode, bool isDown)
+    {
+        KBDLLHOOKSTRUCT keyboard = {};
+        keyboard.vkCode = static_cast<DWORD>(vkCode);
+        keyboard.flags = isDown ? 0 : LLKHF_UP;
+        HookCapture::capture(keyboard, isDown);
+        KeyEvent event;
+        while (HookCapture::ring.pop(event))
+        {
+            KeyEngine::processKeyEvent(event);
+            captured++;
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    const uint64_t rounds = test::iterations(argc, argv, 200000);
+    NullBackend backend;
+    InjectionBatcher::setBackend(&backend);
+    const std::vector<int> keys = activationKeys();
+    CHECK_EQ(keys.size(), 100u);
+
+    double single = 0.0;
+    for (size_t modeCount : {1, 10, 100})
+    {
+        while (Mode::modes.size() < modeCount)
+        {
+            std::unordered_map<int, int> mapping;
+            for (int i = 0; MAPPED[i]; i++)
+            {
+                mapping[MAPPED[i]] = '0' + i;
+            }
+            Mode::modes.push_back(new Mode("mode" + std::to_string(Mode::modes.size()), mapping, {keys[Mode::modes.size()]}));
+        }
+        Mode::compileDispatchTables();
+
+        // Each round: activate a mode (cycling through all of them), type two mapped keys
+        // and an unmapped one, and leave it.
+        captured = 0;
+        const uint64_t elapsed = test::timeIt([&]
+                                              {
+            for (uint64_t round = 0; round < rounds; round++)
+            {
+                const int activation = keys[round % modeCount];
+                const int mapped = MAPPED[round % 10];
+                key(activation, true);
+                key(mapped, true);
+                key(mapped, false);
+                key('Q' == mapped ? 'W' : 'Q', true);
+                key('Q' == mapped ? 'W' : 'Q', false);
+                key(UNMAPPED, true);
+                key(UNMAPPED, false);
+                key(activation, false);
+            } });
+        CHECK_EQ(captured, rounds * 8);
+        test::report(std::to_string(modeCount) + " modes, event", elapsed, captured);
+        const double perEvent = static_cast<double>(elapsed) / static_cast<double>(captured);
+        if (modeCount == 1)
+        {
+            single = perEvent;
+        }
+        // Generous: only a cost that scales with the mode count would get near this.
+        CHECK(perEvent < single * 4.0);
+    }
+    CHECK(backend.events > 0);
+    return test::result();
+}
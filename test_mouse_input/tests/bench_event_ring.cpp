@@ -0,0 +1,118 @@
+// EventRing throughput between a producer (the hook) and a consumer thread (the engine),
+// with the ring's own accounting checked: records arrive in order, every record is either
+// delivered or counted as an overflow, and the high-water mark tracks the fill level.
+// Usage: bench_event_ring [events]
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "TestSupport.h"
+#include "EventRing.h"
+#include "HookCapture.h"
+
+namespace
+{
+    typedef EventRing<KeyEvent, HookCapture::RING_CAPACITY> Ring;
+
+    struct Consumed
+    {
+        uint64_t count = 0;
+        uint64_t outOfOrder = 0;
+    };
+
+    // Pop until 'done' and the ring is empty, checking records come out in push order.
+    void consume(Ring &ring, std::atomic<bool> &done, Consumed &out, bool slow)
+    {
+        KeyEvent event;
+        uint64_t last = 0;
+        for (;;)
+        {
+            if (!ring.pop(event))
+            {
+                if (done.load(std::memory_order_acquire) && ring.size() == 0)
+                {
+                    return;
+                }
+                std::this_thread::yield();
+                continue;
+            }
+            out.outOfOrder += event.timestamp <= last ? 1 : 0;
+            last = event.timestamp;
+            out.count++;
+            if (slow && out.count % 64 == 0)
+            {
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
+        }
+    }
+
+    KeyEvent numbered(uint64_t sequence)
+    {
+        KeyEvent event;
+        event.vkCode = static_cast<uint16_t>(sequence & 0xFF);
+        event.timestamp = sequence;
+        return event;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    const uint64_t events = test::iterations(argc, argv, 10000000);
+
+    // Bursts no larger than the ring, each drained before the next: nothing may be lost.
+    {
+        static Ring ring;
+        std::atomic<bool> done{false};
+        Consumed consumed;
+        std::thread consumer(consume, std::ref(ring), std::ref(done), std::ref(consumed), false);
+        const uint64_t BURST = Ring::capacity() / 2;
+        const uint64_t elapsed = test::timeIt([&]
+                                              {
+            uint64_t sequence = 1;
+            while (sequence <= events)
+            {
+                for (uint64_t i = 0; i < BURST && sequence <= events; i++)
+                {
+                    ring.push(numbered(sequence++));
+                }
+                while (ring.size() > 0)
+                {
+                    std::this_thread::yield();
+                }
+            }
+            done.store(true, std::memory_order_release);
+            consumer.join(); });
+        test::report("lossless event", elapsed, events);
+        std::cout << "    high-water mark " << ring.highWaterMark() << " of " << Ring::capacity() << std::endl;
+        CHECK_EQ(ring.overflowCount(), 0u);
+        CHECK_EQ(consumed.count, events);
+        CHECK_EQ(consumed.outOfOrder, 0u);
+        CHECK(ring.highWaterMark() <= BURST);
+        CHECK(ring.highWaterMark() > 0);
+    }
+
+    // A consumer that falls behind: the producer never waits, drops what does not fit and
+    // counts it, and the ring fills to capacity.
+    {
+        static Ring ring;
+        std::atomic<bool> done{false};
+        Consumed consumed;
+        std::thread consumer(consume, std::ref(ring), std::ref(done), std::ref(consumed), true);
+        uint64_t accepted = 0;
+        const uint64_t elapsed = test::timeIt([&]
+                                              {
+            for (uint64_t sequence = 1; sequence <= events; sequence++)
+            {
+                accepted += ring.push(numbered(sequence)) ? 1 : 0;
+            }
+            done.store(true, std::memory_order_release);
+            consumer.join(); });
+        test::report("overloaded push", elapsed, events);
+        std::cout << "    " << ring.overflowCount() << " dropped" << std::endl;
+        CHECK(ring.overflowCount() > 0);
+        CHECK_EQ(accepted + ring.overflowCount(), events);
+        CHECK_EQ(consumed.count, accepted);
+        CHECK_EQ(consumed.outOfOrder, 0u);
+        CHECK_EQ(ring.highWaterMark(), Ring::capacity());
+    }
+    return test::result();
+}
@@ -0,0 +1,142 @@
+// Key state under contention: the engine thread writes presses and releases while the
+// hook and physics threads read. KeyStateTable against the unordered_map + mutex it
+// replaced, with the same readers. Reports writer and reader rates; the writer of the
+// lock-free table never waits for a reader.
+// Usage: bench_key_state [writes]
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "TestSupport.h"
+#include "KeyState.h"
+
+namespace
+{
+    const int READERS = 3;
+
+    // The old design: one map of key states behind one mutex.
+    class LockedKeyStates
+    {
+    public:
+        void update(int vkCode, bool isDown, uint64_t timestamp)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            KeyState &state = states[vkCode];
+            state.held = isDown;
+            (isDown ? state.timePressed : state.timeReleased) = timestamp;
+        }
+        bool isHeld(int vkCode)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto found = states.find(vkCode);
+            return found != states.end() && found->second.held;
+        }
+        uint64_t newestPress()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            uint64_t newest = 0;
+            for (const auto &entry : states)
+            {
+                newest = std::max(newest, entry.second.timePressed);
+            }
+            return newest;
+        }
+
+    private:
+        std::mutex mutex;
+        std::unordered_map<int, KeyState> states;
+    };
+
+    KeyStateTable table;
+    LockedKeyStates locked;
+
+    // One reader = the hook asking about single keys, then the physics thread taking a
+    // whole picture, in a loop until the writer is done. Each reader reads once before it
+    // counts as started, so every reader gets in even on a single core.
+    template <typename Read>
+    void runReaders(std::atomic<bool> &done, std::atomic<int> &started, std::vector<uint64_t> &reads, Read read)
+    {
+        std::vector<std::thread> threads;
+        for (int r = 0; r < READERS; r++)
+        {
+            threads.emplace_back([&, r]
+                                 {
+                                     uint64_t count = 0;
+                                     read(count++);
+                                     started.fetch_add(1, std::memory_order_release);
+                                     while (!done.load(std::memory_order_acquire))
+                                     {
+                                         read(count);
+                                         count++;
+                                     }
+                                     reads[r] = count; });
+        }
+        for (std::thread &thread : threads)
+        {
+            thread.join();
+        }
+    }
+
+    template <typename Write, typename Read>
+    void contend(const char *what, uint64_t writes, Write write, Read read)
+    {
+        std::atomic<bool> done{false};
+        std::atomic<int> started{0};
+        std::vector<uint64_t> reads(READERS, 0);
+        // One write first, so the readers never see an empty table.
+        write(0x30, true, 0);
+        std::thread readers([&]
+                            { runReaders(done, started, reads, read); });
+        while (started.load(std::memory_order_acquire) < READERS)
+        {
+            std::this_thread::yield();
+        }
+        const uint64_t elapsed = test::timeIt([&]
+                                              {
+            for (uint64_t i = 1; i <= writes; i++)
+            {
+                write(static_cast<int>(i % 64) + 0x30, (i & 64) == 0, i);
+            } });
+        done.store(true, std::memory_order_release);
+        readers.join();
+        uint64_t totalReads = 0;
+        for (uint64_t count : reads)
+        {
+            totalReads += count;
+        }
+        test::report(std::string(what) + " write", elapsed, writes);
+        std::cout << "    " << totalReads << " reads by " << READERS << " readers meanwhile" << std::endl;
+        CHECK(totalReads > 0);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    const uint64_t writes = test::iterations(argc, argv, 5000000);
+
+    static KeySnapshot snapshot;
+    contend("KeyStateTable", writes, [](int vk, bool down, uint64_t t)
+            {
+                if (down)
+                    table.press(vk, t);
+                else
+                    table.release(vk, t); },
+            [](uint64_t n)
+            {
+                if (n % 16 == 0)
+                    table.snapshot(snapshot);
+                else
+                    (void)table.isHeld(static_cast<int>(n % 64) + 0x30); });
+    CHECK(snapshot.version > 0);
+
+    contend("unordered_map + mutex", writes, [](int vk, bool down, uint64_t t)
+            { locked.update(vk, down, t); },
+            [](uint64_t n)
+            {
+                if (n % 16 == 0)
+                    (void)locked.newestPress();
+                else
+                    (void)locked.isHeld(static_cast<int>(n % 64) + 0x30); });
+    return test::result();
+}
@@ -0,0 +1,77 @@
+// Per-call cost of logging on the key path: Log::write (one record into the calling
+// thread's ring) against formatting and writing the line synchronously, which is what the
+// key path used to do with std::cout. Each call is timed on its own; p50/p99/max come from
+// a LatencyHistogram. The log output itself goes to /dev/null.
+// Usage: bench_log [calls]
+#include <chrono>
+#include <cstdio>
+#include <fcntl.h>
+#include <sstream>
+#include <thread>
+#include <unistd.h>
+#include "TestSupport.h"
+#include "LatencyHistogram.h"
+#include "Log.h"
+
+namespace
+{
+    LatencyHistogram asyncCalls, syncCalls;
+
+    void print(const char *what, const LatencyHistogram &histogram)
+    {
+        std::cout << what << ": p50 " << histogram.percentile(50) << " ns, p99 " << histogram.percentile(99)
+                  << " ns, max " << histogram.max() << " ns over " << histogram.count() << " calls" << std::endl;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    const uint64_t calls = test::iterations(argc, argv, 1000000);
+    // A quarter of a ring per burst, then a pause for the formatter to catch up (it polls
+    // every millisecond while busy), so nothing is dropped and every call measures the
+    // fast path.
+    const uint64_t BURST = Log::RING_CAPACITY / 4;
+
+    std::fflush(stdout);
+    const int console = dup(STDOUT_FILENO);
+    const int devNull = ::open("/dev/null", O_WRONLY);
+    dup2(devNull, STDOUT_FILENO);
+
+    Log::start();
+    for (uint64_t done = 0; done < calls;)
+    {
+        for (uint64_t i = 0; i < BURST && done < calls; i++, done++)
+        {
+            const uint64_t start = EventClock::systemNow();
+            Log::write(LOG_LEVEL_INFO, "Key down: {} remapped to {} at {}", static_cast<int>(done & 0xFF), 'B', done);
+            asyncCalls.record(EventClock::systemNow() - start);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    Log::stop();
+
+    FILE *sink = fdopen(dup(devNull), "w");
+    for (uint64_t done = 0; done < calls; done++)
+    {
+        const uint64_t start = EventClock::systemNow();
+        std::ostringstream line;
+        line << "Key down: " << (done & 0xFF) << " remapped to " << 'B' << " at " << done << '\n';
+        const std::string text = line.str();
+        std::fwrite(text.data(), 1, text.size(), sink);
+        std::fflush(sink);
+        syncCalls.record(EventClock::systemNow() - start);
+    }
+    std::fclose(sink);
+
+    std::fflush(stdout);
+    dup2(console, STDOUT_FILENO);
+    ::close(console);
+    ::close(devNull);
+
+    print("Log::write", asyncCalls);
+    print("synchronous line", syncCalls);
+    CHECK_EQ(Log::droppedCount(), 0u);
+    CHECK_EQ(asyncCalls.count(), calls);
+    CHECK(asyncCalls.percentile(50) < syncCalls.percentile(50));
+    return test::result();
+}
@@ -0,0 +1,96 @@
+// Macro throughput: keys mapped to macros of increasing length, tapped through capture and
+// the engine into a backend that only counts. Each tap is one macro played from the
+// MacroTable, so the cost per output event should fall as the macros get longer, and
+// macros longer than a batch are submitted whole rather than in MAX_BATCH slices.
+// Usage: bench_macro [taps]
+#include <string>
+#include <vector>
+#include "TestSupport.h"
+#include "HookCapture.h"
+#include "InjectionBatcher.h"
+#include "KeyEngine.h"
+#include "Macro.h"
+#include "ModeManager.h"
+
+namespace
+{
+    class NullBackend : public OutputBackend
+    {
+    public:
+        uint64_t events = 0;
+        uint64_t submits = 0;
+        void submit(const OutputEvent *, size_t count) override
+        {
+            events += count;
+            submits++;
+        }
+    };
+
+    const int ACTIVATION = 'A';
+
+    void key(int vkCode, bool isDown)
+    {
+        KBDLLHOOKSTRUCT keyboard = {};
+        keyboard.vkCode = static_cast<DWORD>(vkCode);
+        keyboard.flags = isDown ? 0 : LLKHF_UP;
+        HookCapture::capture(keyboard, isDown);
+        KeyEvent event;
+        while (HookCapture::ring.pop(event))
+        {
+            KeyEngine::processKeyEvent(event);
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    const uint64_t taps = test::iterations(argc, argv, 100000);
+    NullBackend backend;
+    InjectionBatcher::setBackend(&backend);
+
+    struct Case
+    {
+        int vkCode;
+        std::string text;
+        size_t events;
+    };
+    std::vector<Case> cases = {
+        {'S', "{ctrl+c}", 0},
+        {'D', "hello", 0},
+        {'F', "Hello, World!{enter}", 0},
+        {'G', std::string(100, 'x'), 0},
+    };
+    Mode *mode = new Mode("macros", {}, {ACTIVATION});
+    for (Case &c : cases)
+    {
+        std::vector<OutputEvent> events;
+        std::string error;
+        CHECK(MacroCompiler::compile(c.text, events, error));
+        c.events = events.size();
+        mode->setMacro(c.vkCode, events);
+    }
+    Mode::modes.push_back(mode);
+    Mode::compileDispatchTables();
+
+    key(ACTIVATION, true);
+    for (const Case &c : cases)
+    {
+        backend.events = 0;
+        backend.submits = 0;
+        const uint64_t elapsed = test::timeIt([&]
+                                              {
+            for (uint64_t tap = 0; tap < taps; tap++)
+            {
+                key(c.vkCode, true);
+                key(c.vkCode, false);
+            } });
+        CHECK_EQ(backend.events, taps * c.events);
+        // One submit per tap, however long the macro.
+        CHECK_EQ(backend.submits, taps);
+        test::report(std::to_string(c.events) + "-event macro, output event", elapsed, backend.events);
+        std::cout << "  " << static_cast<double>(backend.events) * 1e9 / static_cast<double>(elapsed ? elapsed : 1)
+                  << " events/s" << std::endl;
+    }
+    key(ACTIVATION, false);
+    return test::result();
+}
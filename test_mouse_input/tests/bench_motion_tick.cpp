@@ -0,0 +1,46 @@
+// Cost of one SpaceMode motion tick under each preset: at 125 Hz with a 1 ms physics step a
+// tick integrates 8 steps on each of the four axes (cursor x/y, scroll vertical/horizontal).
+// Usage: bench_motion_tick [ticks]
+#include <string>
+#include "TestSupport.h"
+#include "MotionCurve.h"
+#include "MotionIntegrator.h"
+
+int main(int argc, char *argv[])
+{
+    const uint64_t ticks = test::iterations(argc, argv, 1000000);
+    const int STEPS_PER_TICK = 8;
+    const double STEP = 0.001;
+
+    for (const std::string name : {"classic", "precise", "fast", "smooth"})
+    {
+        MotionProfile cursor, scroll;
+        CHECK(MotionProfile::preset(name, MotionProfile::CURSOR, cursor));
+        CHECK(MotionProfile::preset(name, MotionProfile::SCROLL, scroll));
+        MotionAxisIntegrator axes[4];
+        axes[0].configure(&cursor, STEP);
+        axes[1].configure(&cursor, STEP);
+        axes[2].configure(&scroll, STEP);
+        axes[3].configure(&scroll, STEP);
+
+        int64_t travelled = 0;
+        const uint64_t elapsed = test::timeIt([&]
+                                              {
+            for (uint64_t tick = 0; tick < ticks; tick++)
+            {
+                // Hold for 1.5 s, then let go for 1 s, so both the speed and glide curves run.
+                const double thrust = tick % 312 < 187 ? 1.0 : 0.0;
+                for (MotionAxisIntegrator &axis : axes)
+                {
+                    for (int i = 0; i < STEPS_PER_TICK; i++)
+                    {
+                        axis.step(thrust);
+                    }
+                    travelled += axis.take();
+                }
+            } });
+        CHECK(travelled > 0);
+        test::report(name + " tick", elapsed, ticks);
+    }
+    return test::result();
+}
@@ -0,0 +1,63 @@
+// UinputBackend throughput: output events per second and the cost of one flush (one
+// submit() of a batch). Uses real uinput devices when /dev/uinput can be opened, otherwise
+// writes to /dev/null, which still measures translation and the write() calls.
+// Usage: bench_uinput [batches]
+#include <fcntl.h>
+#include <unistd.h>
+#include "TestSupport.h"
+#include "InjectionBatcher.h"
+#include "UinputBackend.h"
+
+int main(int argc, char *argv[])
+{
+    const uint64_t batches = test::iterations(argc, argv, 200000);
+
+    UinputBackend backend;
+    if (!backend.open(1920, 1080))
+    {
+        std::cout << "no /dev/uinput; writing to /dev/null" << std::endl;
+        backend.attach(::open("/dev/null", O_WRONLY), ::open("/dev/null", O_WRONLY), 1920, 1080);
+    }
+    CHECK(backend.isOpen());
+
+    // Typical batches: a remapped tap, a physics tick's move and scroll, a click, and a
+    // full macro; one of them jumps the pointer, which switches device mid-batch.
+    OutputEvent tap[2] = {OutputEvent::key('B', true), OutputEvent::key('B', false)};
+    OutputEvent tick[2] = {OutputEvent::move(3, -1), OutputEvent::wheel(0, 40)};
+    OutputEvent click[3] = {OutputEvent::moveTo(400, 300), OutputEvent::mouseButton(MOUSE_LEFT, true), OutputEvent::mouseButton(MOUSE_LEFT, false)};
+    OutputEvent macro[InjectionBatcher::MAX_BATCH];
+    for (size_t i = 0; i < InjectionBatcher::MAX_BATCH; i++)
+    {
+        macro[i] = OutputEvent::key('A' + static_cast<int>(i / 2 % 26), i % 2 == 0);
+    }
+    struct
+    {
+        const char *name;
+        const OutputEvent *events;
+        size_t count;
+    } kinds[] = {
+        {"tap", tap, 2},
+        {"tick", tick, 2},
+        {"click", click, 3},
+        {"macro", macro, InjectionBatcher::MAX_BATCH},
+    };
+
+    for (const auto &kind : kinds)
+    {
+        const uint64_t writesBefore = backend.writeCount();
+        const uint64_t elapsed = test::timeIt([&]
+                                              {
+            for (uint64_t i = 0; i < batches; i++)
+            {
+                backend.submit(kind.events, kind.count);
+            } });
+        const uint64_t writes = backend.writeCount() - writesBefore;
+        test::report(std::string(kind.name) + " flush", elapsed, batches);
+        std::cout << "    " << static_cast<double>(kind.count * batches) * 1e9 / static_cast<double>(elapsed ? elapsed : 1)
+                  << " events/s, " << static_cast<double>(writes) / static_cast<double>(batches) << " writes per flush" << std::endl;
+        CHECK(writes >= batches);
+    }
+    // One write per device run: the click batch takes two, everything else one.
+    CHECK_EQ(backend.writeCount(), batches * 5);
+    return test::result();
+}
@@ -0,0 +1,157 @@
+// DisplayLayout on synthetic multi-monitor desktops: monitorAt() agrees with a plain scan of
+// the monitors everywhere, off-monitor points clamp onto the nearest monitor, and
+// DisplayGeometry only hands out a new copy when the layout changed.
+#include <vector>
+#include "TestSupport.h"
+#include "DisplayGeometry.h"
+
+namespace
+{
+    MonitorInfo monitor(int left, int top, int width, int height, bool primary = false)
+    {
+        MonitorInfo m;
+        m.left = left;
+        m.top = top;
+        m.right = left + width;
+        m.bottom = top + height;
+        m.primary = primary ? 1 : 0;
+        return m;
+    }
+
+    // What monitorAt() must return: the first monitor containing the point.
+    int scan(const std::vector<MonitorInfo> &monitors, int x, int y)
+    {
+        for (size_t i = 0; i < monitors.size(); i++)
+        {
+            if (monitors[i].contains(x, y))
+            {
+                return static_cast<int>(i);
+            }
+        }
+        return DisplayLayout::NO_MONITOR;
+    }
+
+    // Compare against the scan on a grid over (and beyond) the desktop, including every
+    // edge and the pixel either side of it.
+    void checkLayout(const std::vector<MonitorInfo> &monitors)
+    {
+        DisplayLayout layout;
+        CHECK(layout.build(monitors.data(), static_cast<int>(monitors.size())));
+        CHECK_EQ(layout.count(), static_cast<int>(monitors.size()));
+        const MonitorInfo &desktop = layout.desktop();
+
+        std::vector<int> xs, ys;
+        for (int x = desktop.left - 50; x < desktop.right + 50; x += 37)
+            xs.push_back(x);
+        for (int y = desktop.top - 50; y < desktop.bottom + 50; y += 37)
+            ys.push_back(y);
+        for (const MonitorInfo &m : monitors)
+        {
+            for (int d = -1; d <= 1; d++)
+            {
+                xs.push_back(m.left + d);
+                xs.push_back(m.right + d);
+                ys.push_back(m.top + d);
+                ys.push_back(m.bottom + d);
+            }
+        }
+        int mismatches = 0;
+        int badClamps = 0;
+        for (int x : xs)
+        {
+            for (int y : ys)
+            {
+                const int expected = scan(monitors, x, y);
+                mismatches += layout.monitorAt(x, y) != expected ? 1 : 0;
+
+                int cx = x, cy = y;
+                const bool moved = layout.clamp(cx, cy);
+                // Points on a monitor stay put; others land on the monitor nearest to them.
+                const bool ok = expected != DisplayLayout::NO_MONITOR
+                                    ? !moved && cx == x && cy == y
+                                    : moved && layout.monitorAt(cx, cy) == layout.nearestMonitor(x, y);
+                badClamps += ok ? 0 : 1;
+            }
+        }
+        CHECK_EQ(mismatches, 0);
+        CHECK_EQ(badClamps, 0);
+    }
+}
+
+int main()
+{
+    // Two monitors of different sizes, the second higher up: holes above and below.
+    checkLayout({monitor(0, 0, 1920, 1080, true), monitor(1920, -200, 2560, 1440)});
+    // A monitor left of the primary, at negative coordinates.
+    checkLayout({monitor(0, 0, 1920, 1080, true), monitor(-1280, 56, 1280, 1024)});
+    // Stacked, with a laptop panel below and off to one side.
+    checkLayout({monitor(0, 0, 2560, 1440, true), monitor(320, 1440, 1920, 1200), monitor(2560, 400, 1080, 1920)});
+    // Five monitors around a hole in the middle.
+    checkLayout({monitor(0, 0, 1000, 500, true), monitor(1000, 0, 1000, 500), monitor(0, 500, 500, 500),
+                 monitor(1500, 500, 500, 500), monitor(0, 1000, 2000, 500)});
+
+    // Exact results for the side-by-side case.
+    {
+        const std::vector<MonitorInfo> monitors = {monitor(0, 0, 1920, 1080, true), monitor(1920, -200, 2560, 1440)};
+        DisplayLayout layout;
+        layout.build(monitors.data(), 2);
+        CHECK_EQ(layout.desktop().left, 0);
+        CHECK_EQ(layout.desktop().top, -200);
+        CHECK_EQ(layout.desktop().right, 4480);
+        CHECK_EQ(layout.desktop().bottom, 1240);
+        CHECK_EQ(layout.monitorAt(1919, 500), 0);
+        CHECK_EQ(layout.monitorAt(1920, 500), 1);
+        CHECK_EQ(layout.monitorAt(100, -1), DisplayLayout::NO_MONITOR);
+        // In the hole above the primary: the primary's top edge is nearer than the second monitor.
+        int x = 100, y = -150;
+        CHECK(layout.clamp(x, y));
+        CHECK_EQ(x, 100);
+        CHECK_EQ(y, 0);
+        // Off the far right edge: pulled back onto the last column.
+        x = 5000;
+        y = 300;
+        CHECK(layout.clamp(x, y));
+        CHECK_EQ(x, 4479);
+        CHECK_EQ(y, 300);
+    }
+
+    // Empty monitors are ignored; so are monitors past MAX_MONITORS.
+    {
+        DisplayLayout layout;
+        const MonitorInfo empty = monitor(0, 0, 0, 1080);
+        CHECK(!layout.build(&empty, 1));
+        CHECK_EQ(layout.count(), 0);
+        CHECK_EQ(layout.nearestMonitor(10, 10), DisplayLayout::NO_MONITOR);
+        int x = 10, y = 10;
+        CHECK(!layout.clamp(x, y));
+
+        std::vector<MonitorInfo> many;
+        for (int i = 0; i < DisplayLayout::MAX_MONITORS + 4; i++)
+        {
+            many.push_back(monitor(i * 800, 0, 800, 600));
+        }
+        CHECK(layout.build(many.data(), static_cast<int>(many.size())));
+        CHECK_EQ(layout.count(), DisplayLayout::MAX_MONITORS);
+        CHECK_EQ(layout.monitorAt(DisplayLayout::MAX_MONITORS * 800 - 1, 0), DisplayLayout::MAX_MONITORS - 1);
+        CHECK_EQ(layout.monitorAt(DisplayLayout::MAX_MONITORS * 800, 0), DisplayLayout::NO_MONITOR);
+    }
+
+    // Readers copy only when a new layout has been published.
+    {
+        const MonitorInfo single = monitor(0, 0, 1280, 720, true);
+        DisplayLayout published;
+        published.build(&single, 1);
+        DisplayGeometry::publish(published);
+        DisplayLayout copy;
+        uint64_t seen = 0;
+        CHECK(DisplayGeometry::update(copy, seen));
+        CHECK_EQ(copy.desktop().right, 1280);
+        CHECK(!DisplayGeometry::update(copy, seen));
+        const std::vector<MonitorInfo> two = {single, monitor(1280, 0, 1280, 720)};
+        published.build(two.data(), 2);
+        DisplayGeometry::publish(published);
+        CHECK(DisplayGeometry::update(copy, seen));
+        CHECK_EQ(copy.count(), 2);
+    }
+    return test::result();
+}
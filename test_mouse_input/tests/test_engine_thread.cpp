@@ -0,0 +1,187 @@
+// Threading of the live pipeline: the hook thread only captures, mode handlers run on the
+// engine thread alone, and output reaches the backend from the injector thread alone.
+// Once the input stops, the engine, injector and log formatter threads all stay asleep.
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "TestSupport.h"
+#include "HookCapture.h"
+#include "InjectionBatcher.h"
+#include "InjectionQueue.h"
+#include "KeyEngine.h"
+#include "Log.h"
+#include "ModeManager.h"
+#include "WakeSignal.h"
+
+namespace
+{
+    const int ROUNDS = 2000;
+    const int TAPS = 4;
+
+    // Records which thread every handler call runs on. Engine thread only, so no locking;
+    // the test reads it after joining.
+    class ProbeMode : public Mode
+    {
+    public:
+        using Mode::Mode;
+        std::vector<std::thread::id> callers;
+
+        bool handleKeyDownEvent(int vkCode, uint64_t timestamp) override
+        {
+            callers.push_back(std::this_thread::get_id());
+            return Mode::handleKeyDownEvent(vkCode, timestamp);
+        }
+        bool handleKeyUpEvent(int vkCode, uint64_t timestamp) override
+        {
+            callers.push_back(std::this_thread::get_id());
+            return Mode::handleKeyUpEvent(vkCode, timestamp);
+        }
+    };
+
+    // Records which thread submits, and counts the remapped output.
+    class ThreadRecordingBackend : public OutputBackend
+    {
+    public:
+        std::vector<std::thread::id> callers;
+        uint64_t remapped = 0;
+
+        void submit(const OutputEvent *events, size_t count) override
+        {
+            callers.push_back(std::this_thread::get_id());
+            for (size_t i = 0; i < count; i++)
+            {
+                remapped += events[i].vkCode == 'B' ? 1 : 0;
+            }
+        }
+    };
+
+    WakeSignal engineWake;
+    std::atomic<bool> running{true};
+
+    // As engineThread() in the app.
+    void engineThread()
+    {
+        KeyEvent event;
+        while (running.load())
+        {
+            engineWake.wait();
+            KeyEngine::countWakeup();
+            while (HookCapture::ring.pop(event))
+            {
+                KeyEngine::processKeyEvent(event);
+            }
+        }
+        while (HookCapture::ring.pop(event))
+        {
+            KeyEngine::processKeyEvent(event);
+        }
+    }
+
+    // The hook's part: capture and wake the engine, nothing else.
+    void hookEvent(int vkCode, bool isDown)
+    {
+        while (HookCapture::ring.size() > HookCapture::RING_CAPACITY / 2)
+        {
+            std::this_thread::yield();
+        }
+        KBDLLHOOKSTRUCT keyboard = {};
+        keyboard.vkCode = static_cast<DWORD>(vkCode);
+        keyboard.flags = isDown ? 0 : LLKHF_UP;
+        HookCapture::capture(keyboard, isDown);
+        engineWake.notify();
+    }
+
+    struct Wakeups
+    {
+        uint64_t engine;
+        uint64_t injector;
+        uint64_t formatter;
+    };
+
+    Wakeups wakeups(const InjectionQueue &queue)
+    {
+        return {KeyEngine::wakeupCount(), queue.wakeupCount(), Log::wakeupCount()};
+    }
+}
+
+int main()
+{
+    ProbeMode *probe = new ProbeMode("probe", {{'S', 'B'}}, {'A'});
+    probe->callers.reserve((ROUNDS * TAPS + 1) * 2);
+    Mode::modes.push_back(probe);
+    Mode::compileDispatchTables();
+
+    ThreadRecordingBackend backend;
+    backend.callers.reserve((ROUNDS + 1) * (TAPS * 2 + 2));
+    InjectionQueue queue;
+    queue.start(&backend);
+    InjectionBatcher::setBackend(&queue);
+
+    Log::start();
+    std::thread engine(engineThread);
+    const std::thread::id engineId = engine.get_id();
+    for (int round = 0; round < ROUNDS; round++)
+    {
+        hookEvent('A', true);
+        for (int tap = 0; tap < TAPS; tap++)
+        {
+            hookEvent('S', true);
+            hookEvent('S', false);
+        }
+        hookEvent('A', false);
+    }
+    LOG_INFO("Typed {} rounds", ROUNDS);
+
+    // Idle: no thread may wake at all, not even on a timeout.
+    queue.flush();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    const Wakeups before = wakeups(queue);
+    std::this_thread::sleep_for(std::chrono::milliseconds(400));
+    const Wakeups idle = wakeups(queue);
+    CHECK_EQ(idle.engine, before.engine);
+    CHECK_EQ(idle.injector, before.injector);
+    CHECK_EQ(idle.formatter, before.formatter);
+
+    // ...and each still wakes for new work.
+    hookEvent('A', true);
+    hookEvent('S', true);
+    hookEvent('S', false);
+    hookEvent('A', false);
+    LOG_INFO("Typed one more round");
+    queue.flush();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    const Wakeups busy = wakeups(queue);
+    CHECK(busy.engine > idle.engine);
+    CHECK(busy.injector > idle.injector);
+    CHECK(busy.formatter > idle.formatter);
+
+    running.store(false);
+    engineWake.notify();
+    engine.join();
+    queue.flush();
+    queue.stop();
+    InjectionBatcher::setBackend(nullptr);
+    Log::stop();
+
+    CHECK_EQ(HookCapture::ring.overflowCount(), 0u);
+    CHECK_EQ(probe->callers.size(), static_cast<size_t>((ROUNDS * TAPS + 1) * 2));
+    size_t offEngine = 0;
+    for (const std::thread::id &caller : probe->callers)
+    {
+        offEngine += caller != engineId ? 1 : 0;
+    }
+    CHECK_EQ(offEngine, 0u);
+
+    CHECK_EQ(backend.remapped, static_cast<uint64_t>((ROUNDS * TAPS + 1) * 2));
+    CHECK(!backend.callers.empty());
+    size_t offInjector = 0;
+    for (const std::thread::id &caller : backend.callers)
+    {
+        offInjector += caller != backend.callers.front() ? 1 : 0;
+    }
+    CHECK_EQ(offInjector, 0u);
+    CHECK(backend.callers.front() != engineId);
+    CHECK(backend.callers.front() != std::this_thread::get_id());
+    return test::result();
+}
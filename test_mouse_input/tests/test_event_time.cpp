@@ -0,0 +1,106 @@
+// EventTimeReconciler, fed synthetic (event ms, hook time) pairs: the 32-bit event time
+// unwraps across 2^32 ms, the clock offset follows the least-delayed event and is re-based
+// as the clocks drift, late events keep their own time, and stamps never go backwards.
+#include <cstdint>
+#include "TestSupport.h"
+#include "EventClock.h"
+
+namespace
+{
+    const uint64_t MS = EventClock::MILLISECOND;
+    const uint64_t SECOND = EventClock::SECOND;
+    const uint64_t SLACK = EventTimeReconciler::TICK_SLACK;
+
+    // Deterministic jitter in [0, range).
+    struct Jitter
+    {
+        uint32_t seed;
+        uint64_t next(uint64_t range)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            return (seed >> 8) % range;
+        }
+    };
+}
+
+int main()
+{
+    // Timely events get the hook's own reading; one that queued for longer than a tick
+    // gets its event time instead, and does not move the offset: the next timely event
+    // is still stamped with its hook reading.
+    {
+        EventTimeReconciler reconciler;
+        CHECK_EQ(reconciler.reconcile(1000, 5 * SECOND), 5 * SECOND);
+        CHECK_EQ(reconciler.reconcile(1100, 5 * SECOND + 100 * MS + 2 * MS), 5 * SECOND + 102 * MS);
+        // Generated at 1200 ms (5.2 s on our clock) but only seen 50 ms later.
+        CHECK_EQ(reconciler.reconcile(1200, 5 * SECOND + 250 * MS), 5 * SECOND + 200 * MS + SLACK);
+        CHECK_EQ(reconciler.reconcile(1300, 5 * SECOND + 301 * MS), 5 * SECOND + 301 * MS);
+        // Just inside the slack still counts as timely.
+        CHECK_EQ(reconciler.reconcile(1400, 5 * SECOND + 400 * MS + SLACK), 5 * SECOND + 400 * MS + SLACK);
+        CHECK_EQ(reconciler.reconcile(1500, 5 * SECOND + 500 * MS + SLACK + 1), 5 * SECOND + 500 * MS + SLACK);
+        // A straggler generated before the previous event is clamped to its stamp.
+        CHECK_EQ(reconciler.reconcile(1400, 5 * SECOND + 600 * MS), 5 * SECOND + 500 * MS + SLACK);
+    }
+
+    // A less-delayed event lowers the offset at once, so later delays are measured from it.
+    {
+        EventTimeReconciler reconciler;
+        // The first event queued for 30 ms, so the first offset is 30 ms too high.
+        CHECK_EQ(reconciler.reconcile(1000, 5 * SECOND + 30 * MS), 5 * SECOND + 30 * MS);
+        CHECK_EQ(reconciler.reconcile(1100, 5 * SECOND + 100 * MS), 5 * SECOND + 100 * MS);
+        CHECK_EQ(reconciler.reconcile(1200, 5 * SECOND + 230 * MS), 5 * SECOND + 200 * MS + SLACK);
+    }
+
+    // The event time wraps every 2^32 ms (49.7 days); the stamps carry on across it.
+    {
+        EventTimeReconciler reconciler;
+        const uint64_t start = 60 * SECOND;
+        const uint32_t beforeWrap = 0xFFFFFF00u; // 256 ms before the wrap
+        CHECK_EQ(reconciler.reconcile(beforeWrap, start), start);
+        CHECK_EQ(reconciler.reconcile(beforeWrap + 200, start + 200 * MS), start + 200 * MS);
+        CHECK_EQ(reconciler.reconcile(0x100u, start + 512 * MS), start + 512 * MS);
+        // Delayed by 100 ms just after the wrap: stamped at its own (unwrapped) time.
+        CHECK_EQ(reconciler.reconcile(0x200u, start + 868 * MS), start + 768 * MS + SLACK);
+        CHECK_EQ(reconciler.reconcile(0x300u, start + 1024 * MS), start + 1024 * MS);
+        // An event stamped slightly before the previous one is not a wrap the other way.
+        CHECK_EQ(reconciler.reconcile(0x2FFu, start + 1025 * MS), start + 1025 * MS);
+        CHECK_EQ(reconciler.reconcile(0x400u, start + 1280 * MS), start + 1280 * MS);
+    }
+
+    // Drift: our clock gains 1 ms per second on the event clock. Without re-basing, the
+    // offset found at the start would soon make every timely event look delayed; with it
+    // the offset is never more than OFFSET_WINDOW of drift old, well within the slack.
+    {
+        EventTimeReconciler reconciler;
+        const uint64_t start = 100 * SECOND;
+        for (uint64_t s = 0; s <= 60; s++)
+        {
+            const uint64_t now = start + s * SECOND + s * MS;
+            const uint32_t eventMs = static_cast<uint32_t>(7000 + s * 1000);
+            CHECK_EQ(reconciler.reconcile(eventMs, now), now);
+        }
+    }
+
+    // Never backwards, and never later than the hook's reading, whatever the mix of
+    // delays, out-of-order stamps and coarse 16 ms event ticks.
+    {
+        EventTimeReconciler reconciler;
+        Jitter jitter{42};
+        uint64_t now = 200 * SECOND;
+        uint64_t last = 0;
+        for (int i = 0; i < 100000; i++)
+        {
+            now += jitter.next(30 * MS);
+            const uint64_t delay = jitter.next(8) == 0 ? jitter.next(200 * MS) : jitter.next(2 * MS);
+            // The event clock ticks in 16 ms steps and wraps part-way through the run.
+            const uint64_t generated = now - delay;
+            const uint32_t eventMs = static_cast<uint32_t>(((generated / MS) / 16) * 16 + 0xFFFFFFFFull - 800000);
+            const uint64_t stamp = reconciler.reconcile(eventMs, now);
+            CHECK(stamp >= last);
+            CHECK(stamp <= now);
+            last = stamp;
+        }
+        CHECK(last > 200 * SECOND);
+    }
+    return test::result();
+}
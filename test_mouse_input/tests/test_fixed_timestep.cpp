@@ -0,0 +1,133 @@
+// FixedTimestep and MotionAxisIntegrator under a VirtualClock: however often (or
+// irregularly) the motion is ticked, the same key presses must cover the same distance.
+#include <cstdint>
+#include <vector>
+#include "TestSupport.h"
+#include "EventClock.h"
+#include "MotionCurve.h"
+#include "MotionIntegrator.h"
+
+namespace
+{
+    const uint64_t MS = EventClock::MILLISECOND;
+    const uint64_t START = EventClock::SECOND;
+
+    // Deterministic tick intervals: fixed, or uniformly jittered in [low, high] ns.
+    struct Intervals
+    {
+        uint64_t low;
+        uint64_t high;
+        uint32_t seed = 12345;
+
+        uint64_t next()
+        {
+            seed = seed * 1664525u + 1013904223u;
+            return low + (high > low ? (seed >> 8) % (high - low + 1) : 0);
+        }
+    };
+
+    struct KeyChange
+    {
+        uint64_t time; // ns after START
+        double thrust;
+    };
+
+    // Hold right for 700 ms, both keys for 300 ms, reverse for 200 ms, then glide out.
+    const std::vector<KeyChange> PRESSES = {
+        {100 * MS, 1.0},
+        {800 * MS, 3.0},
+        {1100 * MS, -1.0},
+        {1300 * MS, 0.0},
+    };
+    const uint64_t END = 3000 * MS;
+
+    struct Result
+    {
+        uint64_t steps = 0;
+        int64_t distance = 0;
+        uint64_t ticks = 0;
+    };
+
+    // Tick on 'intervals', plus a tick at each key change (as SpaceMode is woken by key
+    // events), reading the time from EventClock like the polling thread.
+    Result simulate(const MotionProfile &profile, Intervals intervals)
+    {
+        VirtualClock::set(START);
+        FixedTimestep timestep;
+        MotionAxisIntegrator axis;
+        axis.configure(&profile, timestep.stepSeconds());
+        timestep.advance(EventClock::now());
+
+        Result result;
+        double thrust = 0.0;
+        size_t nextPress = 0;
+        uint64_t time = START;
+        while (time < START + END)
+        {
+            uint64_t nextTick = time + intervals.next();
+            const bool keyEvent = nextPress < PRESSES.size() && START + PRESSES[nextPress].time <= nextTick;
+            if (keyEvent)
+            {
+                nextTick = START + PRESSES[nextPress].time;
+            }
+            time = std::min(nextTick, START + END);
+            VirtualClock::set(time);
+            const uint32_t steps = timestep.advance(EventClock::now());
+            for (uint32_t i = 0; i < steps; i++)
+            {
+                axis.step(thrust);
+            }
+            result.steps += steps;
+            result.distance += axis.take();
+            result.ticks++;
+            if (keyEvent && time == START + PRESSES[nextPress].time)
+            {
+                thrust = PRESSES[nextPress++].thrust;
+            }
+        }
+        return result;
+    }
+}
+
+int main()
+{
+    VirtualClock::install();
+
+    // The basics: the first call only starts the clock, remainders carry over, long gaps
+    // are dropped.
+    {
+        FixedTimestep timestep;
+        CHECK_EQ(timestep.advance(START), 0u);
+        CHECK_EQ(timestep.advance(START + 2500 * EventClock::MICROSECOND), 2u);
+        CHECK_EQ(timestep.advance(START + 3000 * EventClock::MICROSECOND), 1u);
+        CHECK_EQ(timestep.advance(START + 3000 * EventClock::MICROSECOND + FixedTimestep::MAX_GAP + 1), 0u);
+        CHECK_EQ(timestep.advance(START + 3000 * EventClock::MICROSECOND + FixedTimestep::MAX_GAP + 1 + 4 * MS), 4u);
+    }
+
+    for (const char *name : {"classic", "precise", "fast", "smooth"})
+    {
+        MotionProfile profile;
+        CHECK(MotionProfile::preset(name, MotionProfile::CURSOR, profile));
+
+        const Result reference = simulate(profile, {MS, MS});
+        CHECK_EQ(reference.steps, END / MS);
+        CHECK(reference.distance > 0);
+
+        const std::vector<Intervals> rates = {
+            {4 * MS, 4 * MS},                   // 250 Hz
+            {8 * MS, 8 * MS},                   // 125 Hz
+            {16666667, 16666667},               // 60 Hz, not a whole number of steps
+            {50 * MS, 50 * MS},                 // 20 Hz
+            {2 * MS, 30 * MS, 1},               // jittered
+            {100 * EventClock::MICROSECOND, 40 * MS, 99}, // badly jittered
+        };
+        for (const Intervals &rate : rates)
+        {
+            const Result result = simulate(profile, rate);
+            CHECK(result.ticks != reference.ticks);
+            CHECK_EQ(result.steps, reference.steps);
+            CHECK_EQ(result.distance, reference.distance);
+        }
+    }
+    return test::result();
+}
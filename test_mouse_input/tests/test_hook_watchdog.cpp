@@ -0,0 +1,194 @@
+// The hook watchdog, driven by a VirtualClock.
+//
+// Liveness: it must not mistake a held key for a dead hook. OS autorepeats are dropped by
+// HookCapture::filterRepeat before capture, but raw input still reports each one, so they
+// have to count as heartbeats (see LowLevelKeyboardProc).
+//
+// Budget: a callback that gets within degradeFraction of the budget degrades the active
+// mode to passthrough; the modes come back only after recoverAfter without another slow
+// callback.
+#include "TestSupport.h"
+#include "EventClock.h"
+#include "HookCapture.h"
+#include "HookWatchdog.h"
+#include "ModeManager.h"
+
+namespace
+{
+    const uint64_t MS = EventClock::MILLISECOND;
+    const uint64_t POLL_INTERVAL = 250 * MS; // WATCHDOG_POLL_MS
+
+    // One keyboard event as the app sees it: raw input reports it to the watchdog, and the
+    // hook (if it is still installed) handles it the way LowLevelKeyboardProc does.
+    void deliver(HookWatchdog &watchdog, int vkCode, bool isDown, uint64_t now, bool hookInstalled = true)
+    {
+        watchdog.onObservedInput(now);
+        if (!hookInstalled)
+        {
+            return;
+        }
+        KBDLLHOOKSTRUCT keyboard = {};
+        keyboard.vkCode = static_cast<DWORD>(vkCode);
+        keyboard.flags = isDown ? 0 : LLKHF_UP;
+        bool consumeRepeat = false;
+        if (HookCapture::filterRepeat(keyboard, isDown, consumeRepeat))
+        {
+            watchdog.onHeartbeat(now);
+            return;
+        }
+        HookCapture::capture(keyboard, isDown);
+        KeyEvent captured;
+        while (HookCapture::ring.pop(captured))
+        {
+        }
+        watchdog.onCallback(now, 10000);
+    }
+
+    // Hold 'vkCode' for 'heldFor' with OS autorepeats every 33 ms, polling the watchdog
+    // like its timer does. Returns the number of re-installs it asked for.
+    uint64_t holdKey(int vkCode, uint64_t start, uint64_t heldFor, bool hookInstalled = true)
+    {
+        HookWatchdog watchdog;
+        watchdog.onHookInstalled(start);
+        uint64_t nextPoll = start + POLL_INTERVAL;
+        deliver(watchdog, vkCode, true, start, hookInstalled);
+        for (uint64_t t = start + 500 * MS; t < start + heldFor; t += 33 * MS)
+        {
+            for (; nextPoll <= t; nextPoll += POLL_INTERVAL)
+            {
+                watchdog.poll(nextPoll);
+            }
+            deliver(watchdog, vkCode, true, t, hookInstalled);
+        }
+        deliver(watchdog, vkCode, false, start + heldFor, hookInstalled);
+        for (; nextPoll <= start + heldFor + POLL_INTERVAL; nextPoll += POLL_INTERVAL)
+        {
+            watchdog.poll(nextPoll);
+        }
+        return watchdog.getReinstallCount();
+    }
+
+    // A mapped key through the hook, reacting to the watchdog as LowLevelKeyboardProc
+    // does. Returns whether the hook consumed it.
+    bool hookKey(HookWatchdog &watchdog, int vkCode, bool isDown, uint64_t elapsed)
+    {
+        KBDLLHOOKSTRUCT keyboard = {};
+        keyboard.vkCode = static_cast<DWORD>(vkCode);
+        keyboard.flags = isDown ? 0 : LLKHF_UP;
+        const bool consumed = HookCapture::capture(keyboard, isDown);
+        KeyEvent captured;
+        while (HookCapture::ring.pop(captured))
+        {
+        }
+        if (watchdog.onCallback(EventClock::now(), elapsed))
+        {
+            HookCapture::degradeActiveMode();
+        }
+        return consumed;
+    }
+
+    // The watchdog timer's side, as watchdogWndProc.
+    HookWatchdog::Action pollWatchdog(HookWatchdog &watchdog)
+    {
+        const HookWatchdog::Action action = watchdog.poll(EventClock::now());
+        if (action == HookWatchdog::RESTORE_MODES)
+        {
+            for (Mode *mode : Mode::modes)
+            {
+                mode->degraded = false;
+            }
+        }
+        return action;
+    }
+
+    // Tap S (mapped) inside the mode activated by A, with every callback taking 'elapsed'.
+    // Returns whether S was consumed, i.e. the mode was not passed through.
+    bool tapMapped(HookWatchdog &watchdog, uint64_t elapsed = MS)
+    {
+        hookKey(watchdog, 'A', true, MS);
+        const bool consumed = hookKey(watchdog, 'S', true, elapsed);
+        hookKey(watchdog, 'S', false, MS);
+        hookKey(watchdog, 'A', false, MS);
+        return consumed;
+    }
+
+    void testDegradeAndRecover()
+    {
+        Mode::modes.push_back(new Mode("num_mode", {{'S', '2'}}, {'A'}));
+        Mode::compileDispatchTables();
+        VirtualClock::set(100 * EventClock::SECOND);
+        HookWatchdog watchdog;
+        watchdog.onHookInstalled(EventClock::now());
+        const HookWatchdog::Settings &settings = watchdog.getSettings();
+        const uint64_t threshold = static_cast<uint64_t>(settings.degradeFraction * settings.budget);
+
+        // Just under the fraction of the budget: nothing happens.
+        CHECK(tapMapped(watchdog, threshold - 1));
+        CHECK(!watchdog.isDegraded());
+        CHECK_EQ(pollWatchdog(watchdog), HookWatchdog::NO_ACTION);
+
+        // 1. A callback that reaches the fraction degrades the active mode: from the next
+        // event on, the hook passes its keys through.
+        hookKey(watchdog, 'A', true, MS);
+        CHECK(hookKey(watchdog, 'S', true, threshold));
+        CHECK(watchdog.isDegraded());
+        CHECK_EQ(watchdog.getDegradeCount(), 1u);
+        CHECK(Mode::modes.back()->degraded.load());
+        CHECK(!hookKey(watchdog, 'S', false, MS));
+        hookKey(watchdog, 'A', false, MS);
+        const uint64_t degradedAt = EventClock::now();
+
+        // 2. Fast callbacks before recoverAfter has passed: still degraded, still passthrough.
+        for (uint64_t t = 250 * MS; t < settings.recoverAfter; t += 250 * MS)
+        {
+            VirtualClock::set(degradedAt + t);
+            CHECK_EQ(pollWatchdog(watchdog), HookWatchdog::NO_ACTION);
+            CHECK(!tapMapped(watchdog));
+        }
+        CHECK(watchdog.isDegraded());
+
+        // 3. Once recoverAfter has passed without a slow callback, the modes are restored,
+        // exactly once, and the mapped key is consumed again.
+        VirtualClock::set(degradedAt + settings.recoverAfter);
+        CHECK_EQ(pollWatchdog(watchdog), HookWatchdog::RESTORE_MODES);
+        CHECK(!watchdog.isDegraded());
+        CHECK(!Mode::modes.back()->degraded.load());
+        CHECK_EQ(pollWatchdog(watchdog), HookWatchdog::NO_ACTION);
+        CHECK(tapMapped(watchdog));
+
+        // 4. Degrade again; a slow callback part-way through recovery starts the wait over,
+        // without counting as a second degrade.
+        CHECK(tapMapped(watchdog, settings.budget));
+        CHECK_EQ(watchdog.getDegradeCount(), 2u);
+        const uint64_t secondDegrade = EventClock::now();
+        VirtualClock::set(secondDegrade + settings.recoverAfter - 1 * EventClock::SECOND);
+        CHECK_EQ(pollWatchdog(watchdog), HookWatchdog::NO_ACTION);
+        CHECK(!tapMapped(watchdog, threshold));
+        CHECK_EQ(watchdog.getDegradeCount(), 2u);
+        const uint64_t slowAgain = EventClock::now();
+        VirtualClock::set(secondDegrade + settings.recoverAfter);
+        CHECK_EQ(pollWatchdog(watchdog), HookWatchdog::NO_ACTION);
+        CHECK(watchdog.isDegraded());
+        VirtualClock::set(slowAgain + settings.recoverAfter - 1);
+        CHECK_EQ(pollWatchdog(watchdog), HookWatchdog::NO_ACTION);
+        VirtualClock::set(slowAgain + settings.recoverAfter);
+        CHECK_EQ(pollWatchdog(watchdog), HookWatchdog::RESTORE_MODES);
+        CHECK(tapMapped(watchdog));
+        CHECK_EQ(watchdog.getReinstallCount(), 0u);
+    }
+}
+
+int main()
+{
+    VirtualClock::install();
+    const uint64_t repeatsBefore = HookCapture::repeatCount.load();
+    // Well past heartbeatGap (1 s) of nothing but autorepeats.
+    CHECK_EQ(holdKey('D', EventClock::SECOND, 3 * EventClock::SECOND), 0u);
+    CHECK(HookCapture::repeatCount.load() - repeatsBefore > 60);
+
+    // The same input with the hook gone is still caught.
+    CHECK(holdKey('D', 10 * EventClock::SECOND, 3 * EventClock::SECOND, false) > 0);
+
+    testDegradeAndRecover();
+    return test::result();
+}
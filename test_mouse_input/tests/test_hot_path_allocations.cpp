@@ -0,0 +1,79 @@
+// Replays a million key events through a build with NK_ALLOCATION_GUARD, so any heap
+// allocation between the hook and the output backend fails the test (Replay exits 3).
+// Usage: test_hot_path_allocations <modes.json> [events]
+#include <fstream>
+#include <string>
+#include "TestSupport.h"
+#include "AllocationGuard.h"
+#include "Replay.h"
+
+namespace
+{
+    // One round of everything the modes do: remaps, a held remap that repeats, macros,
+    // passthrough typing with OS autorepeats, cursor motion with a reversal, clicks,
+    // scrolling and a leap. Returns the number of events written.
+    uint64_t writeRound(std::ofstream &out, uint64_t &ms)
+    {
+        static const char *const ROUND[] = {
+            "down a", "down s", "up s", "down s", "+400", "up s", "down d", "up d",
+            "down f", "up f", "down g", "up g", "up a",
+            "down x", "down x", "down x", "up x", "down y", "up y",
+            "down space", "down d", "+300", "down a", "+100", "up a", "up d",
+            "down q", "up q", "down e", "up e", "down r", "+200", "up r",
+            "down w", "up w", "down w", "up w", "+400", "up space",
+        };
+        uint64_t events = 0;
+        for (const char *step : ROUND)
+        {
+            if (step[0] == '+')
+            {
+                ms += std::stoul(step + 1);
+                continue;
+            }
+            ms += 15;
+            out << ms << ' ' << step << '\n';
+            events++;
+        }
+        return events;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        std::cerr << "usage: test_hot_path_allocations <modes.json> [events]" << std::endl;
+        return 2;
+    }
+    CHECK(AllocationGuard::enabled());
+
+    const uint64_t wanted = argc > 2 ? std::stoull(argv[2]) : 1000000;
+    Replay::Options options;
+    options.script = "hot_path_script.txt";
+    options.modes = argv[1];
+    // Room for everything the run outputs (about 2.8 per event), or the replay fails.
+    options.maxEvents = static_cast<size_t>(wanted * 3);
+    {
+        std::ofstream script(options.script);
+        uint64_t ms = 0, events = 0;
+        while (events < wanted)
+        {
+            events += writeRound(script, ms);
+        }
+    }
+    // Without a golden trace the replay prints its output; nobody needs a million lines.
+    std::ofstream discard;
+    std::streambuf *const console = std::cout.rdbuf(discard.rdbuf());
+    const int result = Replay::run(options);
+    std::cout.rdbuf(console);
+    CHECK_EQ(result, 0);
+    CHECK_EQ(AllocationGuard::hotPathAllocations(), 0u);
+
+    // And the guard really is watching.
+    {
+        AllocationGuard::Scope hotPath;
+        ::operator delete(::operator new(64));
+    }
+    CHECK_EQ(AllocationGuard::hotPathAllocations(), 1u);
+    return test::result();
+}
@@ -0,0 +1,130 @@
+// InjectionBatcher, observed through RecordingBackend: one submit per unit of work, moves
+// and scrolls merged, cancelled motion dropped, order kept, and oversized batches split.
+#include "TestSupport.h"
+#include "InjectionBatcher.h"
+#include "InputSimulator.h"
+#include "RecordingBackend.h"
+
+namespace
+{
+    RecordingBackend recorder(4096);
+
+    const RecordedEvent &last() { return recorder[recorder.size() - 1]; }
+}
+
+int main()
+{
+    InjectionBatcher::setBackend(&recorder);
+
+    // Outside a Scope every event is its own submit.
+    InjectionBatcher::emit(OutputEvent::key('A', true));
+    InjectionBatcher::emit(OutputEvent::key('A', false));
+    CHECK_EQ(recorder.submitCount(), 2u);
+    CHECK_EQ(recorder.size(), 2u);
+
+    // One key event's work: a tap, three moves and two scrolls become one submit of four
+    // events, with the moves and scrolls merged in place.
+    recorder.clear();
+    {
+        InjectionBatcher::Scope batch;
+        InjectionBatcher::emit(OutputEvent::key('B', true));
+        InjectionBatcher::emit(OutputEvent::move(1, 2));
+        InjectionBatcher::emit(OutputEvent::move(3, -1));
+        InjectionBatcher::emit(OutputEvent::move(-2, 0));
+        InjectionBatcher::emit(OutputEvent::wheel(0, 60));
+        InjectionBatcher::emit(OutputEvent::wheel(0, 60));
+        InjectionBatcher::emit(OutputEvent::key('B', false));
+        CHECK_EQ(recorder.submitCount(), 0u);
+    }
+    CHECK_EQ(recorder.submitCount(), 1u);
+    CHECK_EQ(recorder.size(), 4u);
+    if (recorder.size() == 4)
+    {
+        CHECK(recorder[0].event.kind == OutputKind::KeyDown);
+        CHECK(recorder[1].event.kind == OutputKind::MouseMove);
+        CHECK_EQ(recorder[1].event.dx, 2);
+        CHECK_EQ(recorder[1].event.dy, 1);
+        CHECK(recorder[2].event.kind == OutputKind::Wheel);
+        CHECK_EQ(recorder[2].event.dy, 120);
+        CHECK(recorder[3].event.kind == OutputKind::KeyUp);
+    }
+
+    // Moves either side of a click are not merged across it; moves that cancel out are
+    // not sent at all.
+    recorder.clear();
+    {
+        InjectionBatcher::Scope batch;
+        InjectionBatcher::emit(OutputEvent::move(4, 0));
+        InjectionBatcher::emit(OutputEvent::mouseButton(MOUSE_LEFT, true));
+        InjectionBatcher::emit(OutputEvent::move(5, 0));
+        InjectionBatcher::emit(OutputEvent::move(-5, 0));
+    }
+    CHECK_EQ(recorder.submitCount(), 1u);
+    CHECK_EQ(recorder.size(), 2u);
+    CHECK(last().event.kind == OutputKind::ButtonDown);
+
+    // Nested scopes flush once, at the outermost.
+    recorder.clear();
+    {
+        InjectionBatcher::Scope outer;
+        InjectionBatcher::emit(OutputEvent::key('C', true));
+        {
+            InjectionBatcher::Scope inner;
+            InjectionBatcher::emit(OutputEvent::key('C', false));
+        }
+        CHECK_EQ(recorder.submitCount(), 0u);
+    }
+    CHECK_EQ(recorder.submitCount(), 1u);
+    CHECK_EQ(recorder.size(), 2u);
+
+    // More than a batch holds: full batches go out as they fill, in order.
+    recorder.clear();
+    const size_t MANY = InjectionBatcher::MAX_BATCH * 2 + 6;
+    {
+        InjectionBatcher::Scope batch;
+        for (size_t i = 0; i < MANY; i++)
+        {
+            InjectionBatcher::emit(OutputEvent::key(0x30 + static_cast<int>(i % 10), i % 2 == 0));
+        }
+    }
+    CHECK_EQ(recorder.submitCount(), 3u);
+    CHECK_EQ(recorder.size(), MANY);
+    bool ordered = true;
+    for (size_t i = 0; i < recorder.size(); i++)
+    {
+        ordered = ordered && recorder[i].event.vkCode == 0x30 + i % 10;
+    }
+    CHECK(ordered);
+
+    // A macro is copied in whole; one longer than a batch goes out in a single submit of
+    // its own after whatever was pending.
+    recorder.clear();
+    OutputEvent macro[InjectionBatcher::MAX_BATCH + 10];
+    for (size_t i = 0; i < sizeof(macro) / sizeof(macro[0]); i++)
+    {
+        macro[i] = OutputEvent::key('M', i % 2 == 0);
+    }
+    {
+        InjectionBatcher::Scope batch;
+        InjectionBatcher::emit(OutputEvent::key('D', true));
+        InjectionBatcher::emitAll(macro, 4);
+        InjectionBatcher::emitAll(macro, sizeof(macro) / sizeof(macro[0]));
+        InjectionBatcher::emit(OutputEvent::key('D', false));
+    }
+    CHECK_EQ(recorder.submitCount(), 3u);
+    CHECK_EQ(recorder.size(), 1 + 4 + sizeof(macro) / sizeof(macro[0]) + 1);
+    CHECK_EQ(recorder[0].event.vkCode, 'D');
+    CHECK_EQ(last().event.vkCode, 'D');
+
+    // InputSimulator goes through the same path.
+    recorder.clear();
+    {
+        InjectionBatcher::Scope batch;
+        InputSimulator::simulateKeyTap('E');
+    }
+    CHECK_EQ(recorder.submitCount(), 1u);
+    CHECK_EQ(recorder.size(), 2u);
+
+    InjectionBatcher::setBackend(nullptr);
+    return test::result();
+}
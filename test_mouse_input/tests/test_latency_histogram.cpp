@@ -0,0 +1,136 @@
+// LatencyHistogram: bucket layout, percentile accuracy, overflow, merge and reset.
+#include <cmath>
+#include <cstdint>
+#include "TestSupport.h"
+#include "LatencyHistogram.h"
+
+namespace
+{
+    typedef LatencyHistogram H;
+
+    LatencyHistogram a, b, all;
+
+    void bucketBoundaries()
+    {
+        // Exact below SUB_BUCKET_COUNT.
+        for (uint64_t v = 0; v < H::SUB_BUCKET_COUNT; v++)
+        {
+            CHECK_EQ(H::bucketIndex(v), v);
+            CHECK_EQ(H::bucketUpperBound(v), v);
+        }
+        // Then every bucket starts right after the previous one ends, holds values only
+        // within 1/SUB_BUCKET_COUNT of its lowest, and maps both its ends back to itself.
+        for (size_t i = H::SUB_BUCKET_COUNT; i < H::BUCKET_COUNT; i++)
+        {
+            const uint64_t lower = H::bucketUpperBound(i - 1) + 1;
+            const uint64_t upper = H::bucketUpperBound(i);
+            CHECK(upper >= lower);
+            CHECK_EQ(H::bucketIndex(lower), i);
+            CHECK_EQ(H::bucketIndex(upper), i);
+            CHECK((upper - lower + 1) * H::SUB_BUCKET_COUNT <= lower);
+        }
+        CHECK_EQ(H::bucketIndex(32), 32u);
+        CHECK_EQ(H::bucketIndex(63), 63u);
+        CHECK_EQ(H::bucketIndex(64), 64u);
+        CHECK_EQ(H::bucketIndex(65), 64u);
+        CHECK_EQ(H::bucketIndex(66), 65u);
+        CHECK_EQ(H::bucketUpperBound(H::BUCKET_COUNT - 1), (1ull << (H::MAX_MSB + 1)) - 1);
+    }
+
+    void percentiles()
+    {
+        LatencyHistogram &h = a;
+        h.reset();
+        CHECK_EQ(h.percentile(50), 0u);
+
+        // 1 us .. 100 ms in 1 us steps: the true p-th percentile is p% of the way up.
+        const uint64_t N = 100000;
+        for (uint64_t i = 1; i <= N; i++)
+        {
+            h.record(i * 1000);
+        }
+        CHECK_EQ(h.count(), N);
+        CHECK_EQ(h.max(), N * 1000);
+        for (double p : {1.0, 25.0, 50.0, 90.0, 99.0, 99.9, 99.99})
+        {
+            const uint64_t exact = static_cast<uint64_t>(std::ceil(p / 100.0 * N)) * 1000;
+            const uint64_t reported = h.percentile(p);
+            // Never below the true value, and above it by less than a sub-bucket.
+            CHECK(reported >= exact);
+            CHECK(reported - exact <= exact / H::SUB_BUCKET_COUNT);
+        }
+        CHECK_EQ(h.percentile(100), N * 1000);
+
+        // A single sample is reported exactly (clamped to the max).
+        h.reset();
+        h.record(123456789);
+        CHECK_EQ(h.percentile(50), 123456789u);
+    }
+
+    void overflow()
+    {
+        LatencyHistogram &h = a;
+        h.reset();
+        const uint64_t huge = 1ull << 50;
+        h.record(huge);
+        h.record(~0ull);
+        h.record(10);
+        CHECK_EQ(h.count(), 3u);
+        CHECK_EQ(h.max(), ~0ull);
+        CHECK_EQ(H::bucketIndex(huge), H::BUCKET_COUNT - 1);
+        CHECK_EQ(H::bucketIndex(~0ull), H::BUCKET_COUNT - 1);
+        // Clamped into the last bucket: reported as its top, not lost.
+        CHECK_EQ(h.percentile(100), H::bucketUpperBound(H::BUCKET_COUNT - 1));
+        CHECK_EQ(h.percentile(10), 10u);
+    }
+
+    void mergeAndReset()
+    {
+        a.reset();
+        b.reset();
+        all.reset();
+        for (uint64_t v = 1; v <= 5000; v++)
+        {
+            const uint64_t nanos = v * v * 37;
+            (v % 3 == 0 ? a : b).record(nanos);
+            all.record(nanos);
+        }
+        a.merge(b);
+        CHECK_EQ(a.count(), all.count());
+        CHECK_EQ(a.max(), all.max());
+        for (double p : {0.0, 10.0, 50.0, 95.0, 99.0, 99.9, 100.0})
+        {
+            CHECK_EQ(a.percentile(p), all.percentile(p));
+        }
+
+        // Merging an empty histogram changes nothing; merging into one copies it.
+        b.reset();
+        a.merge(b);
+        CHECK_EQ(a.count(), all.count());
+        b.merge(all);
+        CHECK_EQ(b.count(), all.count());
+        CHECK_EQ(b.max(), all.max());
+        CHECK_EQ(b.percentile(50), all.percentile(50));
+
+        a.reset();
+        CHECK_EQ(a.count(), 0u);
+        CHECK_EQ(a.max(), 0u);
+        CHECK_EQ(a.percentile(99), 0u);
+        for (size_t i = 0; i < H::BUCKET_COUNT; i++)
+        {
+            a.record(H::bucketUpperBound(i));
+        }
+        CHECK_EQ(a.count(), H::BUCKET_COUNT);
+        a.reset();
+        CHECK_EQ(a.percentile(0.001), 0u);
+    }
+}
+
+int main()
+{
+    bucketBoundaries();
+    percentiles();
+    overflow();
+    mergeAndReset();
+    return test::result();
+}
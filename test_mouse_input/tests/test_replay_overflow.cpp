@@ -0,0 +1,30 @@
+// A replay whose output overflows the recording must fail with exit code 4, and
+// --update-golden must not save the truncated trace as a golden one.
+// Usage: test_replay_overflow <replay dir>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include "TestSupport.h"
+#include "Replay.h"
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        std::cerr << "usage: test_replay_overflow <replay dir>" << std::endl;
+        return 2;
+    }
+    const std::string dir = argv[1];
+    Replay::Options options;
+    options.script = dir + "/scroll.txt";
+    options.modes = dir + "/modes.json";
+    options.golden = "overflow_golden.trace";
+    options.updateGolden = true;
+    // The scroll script produces almost 200 events.
+    options.maxEvents = 5;
+    std::remove(options.golden.c_str());
+
+    CHECK_EQ(Replay::run(options), 4);
+    CHECK(!std::ifstream(options.golden).good());
+    return test::result();
+}
@@ -0,0 +1,144 @@
+// Our own output comes back through the keyboard hook. A fake backend loops every key it is
+// given back into the hook stamped the way SendInputBackend stamps it, and the test checks
+// that none of it reaches the event ring or any mode: only the physical keys drive modes.
+#include <vector>
+#include "TestSupport.h"
+#include "EventClock.h"
+#include "HookCapture.h"
+#include "InjectionBatcher.h"
+#include "KeyEngine.h"
+#include "ModeManager.h"
+
+namespace
+{
+    // A plain remapping mode that counts how often its handlers run.
+    class ProbeMode : public Mode
+    {
+    public:
+        using Mode::Mode;
+        int handled = 0;
+
+        bool handleKeyDownEvent(int vkCode, uint64_t timestamp) override
+        {
+            handled++;
+            return Mode::handleKeyDownEvent(vkCode, timestamp);
+        }
+        bool handleKeyUpEvent(int vkCode, uint64_t timestamp) override
+        {
+            handled++;
+            return Mode::handleKeyUpEvent(vkCode, timestamp);
+        }
+    };
+
+    // Hands every key event back to the hook as the system would: flagged as injected and
+    // carrying whatever dwExtraInfo it was sent with.
+    class LoopbackBackend : public OutputBackend
+    {
+    public:
+        ULONG_PTR extraInfo = HookCapture::injectionSignature();
+        std::vector<KBDLLHOOKSTRUCT> pending;
+
+        void submit(const OutputEvent *events, size_t count) override
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                if (events[i].kind != OutputKind::KeyDown && events[i].kind != OutputKind::KeyUp)
+                {
+                    continue;
+                }
+                KBDLLHOOKSTRUCT keyboard = {};
+                keyboard.vkCode = events[i].vkCode;
+                keyboard.flags = LLKHF_INJECTED | (events[i].kind == OutputKind::KeyUp ? LLKHF_UP : 0);
+                keyboard.dwExtraInfo = extraInfo;
+                pending.push_back(keyboard);
+            }
+        }
+    };
+
+    LoopbackBackend loopback;
+    uint64_t captured = 0;
+
+    // LowLevelKeyboardProc's decisions, then the engine thread's drain of the ring.
+    void hook(const KBDLLHOOKSTRUCT &keyboard)
+    {
+        VirtualClock::advance(10 * EventClock::MILLISECOND);
+        if (HookCapture::isSelfInjected(keyboard))
+        {
+            return;
+        }
+        const bool isDown = (keyboard.flags & LLKHF_UP) == 0;
+        bool consumeRepeat = false;
+        if (HookCapture::filterRepeat(keyboard, isDown, consumeRepeat))
+        {
+            return;
+        }
+        HookCapture::capture(keyboard, isDown);
+        KeyEvent event;
+        while (HookCapture::ring.pop(event))
+        {
+            captured++;
+            KeyEngine::processKeyEvent(event);
+        }
+    }
+
+    // A physical key, followed by whatever the modes injected in response.
+    void press(int vkCode, bool isDown)
+    {
+        KBDLLHOOKSTRUCT keyboard = {};
+        keyboard.vkCode = static_cast<DWORD>(vkCode);
+        keyboard.flags = isDown ? 0 : LLKHF_UP;
+        hook(keyboard);
+        std::vector<KBDLLHOOKSTRUCT> injected;
+        injected.swap(loopback.pending);
+        for (const KBDLLHOOKSTRUCT &echo : injected)
+        {
+            hook(echo);
+        }
+    }
+
+    void tap(int vkCode)
+    {
+        press(vkCode, true);
+        press(vkCode, false);
+    }
+}
+
+int main()
+{
+    VirtualClock::install();
+    VirtualClock::set(EventClock::SECOND);
+    InjectionBatcher::setBackend(&loopback);
+
+    // S types B. If our own B came back into the pipeline, 'first' would handle it as one
+    // more key. A released within its timeout is typed, and that A would activate 'first'
+    // again. B is also the key of 'second', which must never become active.
+    ProbeMode *first = new ProbeMode("first", {{'S', 'B'}}, {'A'});
+    ProbeMode *second = new ProbeMode("second", {{'S', 'C'}}, {'B'});
+    Mode::modes.push_back(first);
+    Mode::modes.push_back(second);
+    Mode::compileDispatchTables();
+
+    // Hold A, tap S twice (types B twice), release A; then tap A alone (types A).
+    press('A', true);
+    tap('S');
+    tap('S');
+    press('A', false);
+    tap('A');
+
+    const uint64_t physical = 8;
+    CHECK_EQ(captured, physical);
+    CHECK_EQ(first->handled, 4);
+    CHECK_EQ(second->handled, 0);
+    CHECK(Mode::currentMode == nullptr);
+    // B down/up twice and A down/up twice.
+    CHECK_EQ(HookCapture::selfInjectedCount.load(), 8u);
+
+    // Injected input from anyone else is ordinary input and does reach the mode.
+    loopback.extraInfo = HookCapture::injectionSignature() ^ 1;
+    press('A', true);
+    tap('S');
+    CHECK_EQ(captured, physical + 3 + 2);
+    CHECK_EQ(first->handled, 4 + 2 + 2);
+    CHECK_EQ(HookCapture::selfInjectedCount.load(), 8u);
+    return test::result();
+}
@@ -0,0 +1,133 @@
+// One writer and several readers hammer KeyStateTable::snapshot() and SeqLocked<T>; every
+// copy a reader gets must be a state the writer actually published, never a mix of two.
+// Usage: test_seqlock_stress [writes]
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include "TestSupport.h"
+#include "KeyState.h"
+#include "SeqLock.h"
+
+namespace
+{
+    const int READERS = 3;
+    // The writer presses a new key at every step and releases the one pressed WINDOW steps
+    // earlier, so between writes exactly the last WINDOW presses are held.
+    const uint64_t WINDOW = 8;
+    const int FIRST_KEY = 10;
+    const int KEYS = 100;
+
+    int keyForStep(uint64_t step) { return FIRST_KEY + static_cast<int>(step % KEYS); }
+
+    KeyStateTable table;
+    std::atomic<bool> done{false};
+    std::atomic<int> failures{0};
+
+    // A consistent snapshot holds WINDOW - 1 or WINDOW keys pressed at consecutive steps,
+    // the newest press of all among them, and never goes back in time.
+    void readSnapshots(uint64_t &snapshots)
+    {
+        KeySnapshot snapshot;
+        uint64_t lastVersion = 0;
+        uint64_t lastNewest = 0;
+        while (!done.load(std::memory_order_acquire))
+        {
+            table.snapshot(snapshot);
+            snapshots++;
+            uint64_t lowest = ~0ull, highest = 0, newest = 0;
+            uint64_t held = 0;
+            for (int vk = 0; vk < KeyStateTable::KEY_COUNT; vk++)
+            {
+                const uint64_t pressed = snapshot.timePressed[vk];
+                newest = std::max(newest, pressed);
+                if (snapshot.held.test(vk))
+                {
+                    held++;
+                    lowest = std::min(lowest, pressed);
+                    highest = std::max(highest, pressed);
+                }
+            }
+            bool ok = (snapshot.version & 1) == 0 && snapshot.version >= lastVersion && newest >= lastNewest;
+            if (newest > WINDOW)
+            {
+                ok = ok && (held == WINDOW || held == WINDOW - 1) && highest == newest && highest - lowest + 1 == held;
+            }
+            if (!ok)
+            {
+                failures++;
+            }
+            lastVersion = snapshot.version;
+            lastNewest = newest;
+        }
+    }
+
+    struct Quad
+    {
+        uint64_t n;
+        uint64_t triple;
+        uint64_t inverse;
+        uint64_t mixed;
+    };
+    SeqLocked<Quad> published;
+
+    void readPublished(uint64_t &loads)
+    {
+        uint64_t last = 0;
+        while (!done.load(std::memory_order_acquire))
+        {
+            const Quad q = published.load();
+            loads++;
+            if (q.triple != q.n * 3 || q.inverse != ~q.n || q.mixed != (q.n ^ 0x5A5A5A5A5A5A5A5Aull) || q.n < last)
+            {
+                failures++;
+            }
+            last = q.n;
+        }
+    }
+
+    template <typename Reader, typename Writer>
+    void stress(const char *what, uint64_t writes, Reader reader, Writer writer)
+    {
+        done.store(false);
+        failures.store(0);
+        std::vector<uint64_t> reads(READERS, 0);
+        std::vector<std::thread> threads;
+        for (int i = 0; i < READERS; i++)
+        {
+            threads.emplace_back(reader, std::ref(reads[i]));
+        }
+        for (uint64_t step = 1; step <= writes; step++)
+        {
+            writer(step);
+        }
+        done.store(true, std::memory_order_release);
+        uint64_t total = 0;
+        for (int i = 0; i < READERS; i++)
+        {
+            threads[i].join();
+            total += reads[i];
+        }
+        std::cout << what << ": " << writes << " writes, " << total << " reads" << std::endl;
+        CHECK(total > 0);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    const uint64_t writes = test::iterations(argc, argv, 2000000);
+
+    stress("KeyStateTable", writes, readSnapshots, [](uint64_t step)
+           {
+               if (step > WINDOW)
+               {
+                   table.release(keyForStep(step - WINDOW), step);
+               }
+               table.press(keyForStep(step), step); });
+    CHECK_EQ(failures.load(), 0);
+
+    stress("SeqLocked", writes, readPublished, [](uint64_t step)
+           { published.store({step, step * 3, ~step, step ^ 0x5A5A5A5A5A5A5A5Aull}); });
+    CHECK_EQ(failures.load(), 0);
+    return test::result();
+}
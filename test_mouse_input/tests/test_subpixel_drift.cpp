@@ -0,0 +1,80 @@
+// SubpixelAccumulator over long runs: the whole pixels it hands out plus what it carries
+// must equal everything that was added, to the last fixed-point unit, however many ticks.
+#include <cmath>
+#include <cstdint>
+#include "TestSupport.h"
+#include "SubpixelAccumulator.h"
+
+namespace
+{
+    const int TICKS = 10000;
+
+    // Feed 'delta(i)' for TICKS ticks; fail if the books ever stop balancing.
+    template <typename F>
+    int64_t run(F delta, int64_t &emitted)
+    {
+        SubpixelAccumulator accumulator;
+        int64_t added = 0;
+        emitted = 0;
+        int64_t drift = 0;
+        for (int i = 0; i < TICKS; i++)
+        {
+            const double pixels = delta(i);
+            added += SubpixelAccumulator::toFixed(pixels);
+            emitted += accumulator.add(pixels);
+            drift = added - (emitted * SubpixelAccumulator::ONE + accumulator.remainderFixed());
+            if (drift != 0)
+            {
+                break;
+            }
+        }
+        CHECK(std::abs(accumulator.remainder()) < 1.0);
+        return drift;
+    }
+}
+
+int main()
+{
+    int64_t emitted = 0;
+
+    // Slow constant motion: 0.3 px per tick is 3000 px, not 0 (truncation) or 3000.x drifting.
+    CHECK_EQ(run([](int)
+                 { return 0.3; },
+                 emitted),
+             0);
+    CHECK_EQ(emitted, 3000);
+
+    // The same backwards is the exact mirror.
+    CHECK_EQ(run([](int)
+                 { return -0.3; },
+                 emitted),
+             0);
+    CHECK_EQ(emitted, -3000);
+
+    // An exponential glide decaying to nothing, restarted every 100 ticks.
+    CHECK_EQ(run([](int i)
+                 { return 7.5 * std::pow(0.85, i % 100); },
+                 emitted),
+             0);
+
+    // Speeds that change direction and cross whole pixels irregularly.
+    CHECK_EQ(run([](int i)
+                 { return 2.7 * std::sin(i * 0.013) + 0.05 * std::cos(i * 1.7); },
+                 emitted),
+             0);
+
+    // A shallow diagonal: each axis lands within a pixel of its exact distance (rounding
+    // each delta to 1/65536 px costs at most 0.08 px over the run).
+    int64_t x = 0, y = 0;
+    CHECK_EQ(run([](int)
+                 { return 0.6; },
+                 x),
+             0);
+    CHECK_EQ(run([](int)
+                 { return 0.2; },
+                 y),
+             0);
+    CHECK(std::abs(x - 6000) <= 1);
+    CHECK(std::abs(y - 2000) <= 1);
+    return test::result();
+}
@@ -0,0 +1,89 @@
+// TapHistory, which SpaceMode's double- and triple-tap leaps read: runs of rapid presses,
+// the ring of press times and keys not disturbing each other.
+#include <cstdint>
+#include "TestSupport.h"
+#include "TapHistory.h"
+
+namespace
+{
+    const uint64_t MS = EventClock::MILLISECOND;
+    const uint64_t START = EventClock::SECOND;
+    const uint64_t WINDOW = TapHistory::DEFAULT_WINDOW;
+}
+
+int main()
+{
+    // Runs: presses within the window of the one before extend the run, a slower one
+    // starts a new run, and a press exactly one window later still counts.
+    {
+        TapHistory taps;
+        CHECK_EQ(taps.runLength('A'), 0u);
+        taps.record('A', START);
+        CHECK_EQ(taps.runLength('A'), 1u);
+        taps.record('A', START + 100 * MS);
+        CHECK_EQ(taps.runLength('A'), 2u);
+        taps.record('A', START + 100 * MS + WINDOW);
+        CHECK_EQ(taps.runLength('A'), 3u);
+        taps.record('A', START + 100 * MS + 2 * WINDOW + 1);
+        CHECK_EQ(taps.runLength('A'), 1u);
+        taps.record('A', START + 100 * MS + 2 * WINDOW + 50 * MS);
+        CHECK_EQ(taps.runLength('A'), 2u);
+    }
+
+    // The window is measured from the latest press, not the first of the run, so a run
+    // can go on for longer than one window.
+    {
+        TapHistory taps;
+        taps.setWindow(50 * MS);
+        for (int i = 0; i < 10; i++)
+        {
+            taps.record('W', START + i * 40 * MS);
+        }
+        CHECK_EQ(taps.runLength('W'), 10u);
+        taps.record('W', START + 9 * 40 * MS + 51 * MS);
+        CHECK_EQ(taps.runLength('W'), 1u);
+    }
+
+    // The ring keeps the last CAPACITY press times, newest first, after it has wrapped
+    // several times; 'back' wraps at CAPACITY.
+    {
+        TapHistory taps;
+        CHECK_EQ(taps.pressTime('S', 0), 0u);
+        const int presses = 3 * TapHistory::CAPACITY + 1;
+        for (int i = 1; i <= presses; i++)
+        {
+            taps.record('S', START + i * MS);
+        }
+        for (int back = 0; back < TapHistory::CAPACITY; back++)
+        {
+            CHECK_EQ(taps.pressTime('S', back), START + (presses - back) * MS);
+        }
+        CHECK_EQ(taps.pressTime('S', TapHistory::CAPACITY), taps.pressTime('S', 0));
+        CHECK_EQ(taps.runLength('S'), static_cast<uint32_t>(presses));
+    }
+
+    // Keys are independent: presses of another key in between neither extend nor break
+    // a run, and only the low byte of the key code picks the slot.
+    {
+        TapHistory taps;
+        taps.record('D', START);
+        taps.record('K', START + 10 * MS);
+        taps.record('K', START + 20 * MS);
+        taps.record('K', START + 30 * MS);
+        taps.record('D', START + 150 * MS);
+        CHECK_EQ(taps.runLength('D'), 2u);
+        CHECK_EQ(taps.runLength('K'), 3u);
+        CHECK_EQ(taps.pressTime('D', 1), START);
+        CHECK_EQ(taps.runLength('L'), 0u);
+        CHECK_EQ(taps.pressTime('L', 0), 0u);
+
+        taps.record(0x100 + 'L', START + 200 * MS);
+        CHECK_EQ(taps.runLength('L'), 1u);
+
+        taps.clear();
+        CHECK_EQ(taps.runLength('D'), 0u);
+        CHECK_EQ(taps.runLength('K'), 0u);
+        CHECK_EQ(taps.pressTime('K', 0), 0u);
+    }
+    return test::result();
+}
@@ -0,0 +1,113 @@
+// TickScheduler's spin phase and the tick rates it is asked for: a configured spin never
+// takes more than half of any mode's tick, and each mode's "tick_hz" is the interval the
+// polling thread is handed.
+// Usage: test_tick_scheduler <modes.json> (tests/replay/tick_rates.json)
+#include <string>
+#include "TestSupport.h"
+#include "HookCapture.h"
+#include "InjectionBatcher.h"
+#include "KeyEngine.h"
+#include "ModeManager.h"
+#include "RecordingBackend.h"
+#include "TickScheduler.h"
+
+namespace
+{
+    const uint64_t US = EventClock::MICROSECOND;
+    const uint64_t MS = EventClock::MILLISECOND;
+
+    Mode *findMode(const std::string &name)
+    {
+        for (Mode *mode : Mode::modes)
+        {
+            if (mode->getName() == name)
+            {
+                return mode;
+            }
+        }
+        return nullptr;
+    }
+
+    void key(int vkCode, bool isDown)
+    {
+        KBDLLHOOKSTRUCT keyboard = {};
+        keyboard.vkCode = static_cast<DWORD>(vkCode);
+        keyboard.flags = isDown ? 0 : LLKHF_UP;
+        HookCapture::capture(keyboard, isDown);
+        KeyEvent event;
+        while (HookCapture::ring.pop(event))
+        {
+            KeyEngine::processKeyEvent(event);
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        std::cerr << "usage: test_tick_scheduler <modes.json>" << std::endl;
+        return 2;
+    }
+    VirtualClock::install();
+    VirtualClock::set(EventClock::SECOND);
+    RecordingBackend recorder;
+    recorder.setDesktop(1920, 1080);
+    InjectionBatcher::setBackend(&recorder);
+    Mode::loadModes(argv[1]);
+
+    // Per-mode tick rates: "tick_hz" sets the interval, anything not positive keeps the
+    // mode's default.
+    Mode *fast = findMode("fast_mode");
+    Mode *fallback = findMode("default_mode");
+    Mode *mouse = findMode("Mouse Mode");
+    CHECK(fast != nullptr && fallback != nullptr && mouse != nullptr);
+    if (fast == nullptr || fallback == nullptr || mouse == nullptr)
+    {
+        return test::result();
+    }
+    CHECK_EQ(fast->updateInterval(), 2 * MS);
+    CHECK_EQ(fallback->updateInterval(), Mode("plain", {}, {}).updateInterval());
+    CHECK_EQ(mouse->updateInterval(), 4 * MS);
+    CHECK_EQ(Mode::shortestTickInterval(), 2 * MS);
+
+    // The spin: a short one is used as configured, one as long as the tick (or longer) is
+    // capped at half of it, for every interval the scheduler may be asked to wait.
+    TickScheduler scheduler;
+    CHECK_EQ(scheduler.spinFor(2 * MS), 0u);
+    scheduler.setSpin(300 * US);
+    CHECK_EQ(scheduler.spinFor(2 * MS), 300 * US);
+    CHECK_EQ(scheduler.spinFor(4 * MS), 300 * US);
+    for (uint64_t spin : {2 * MS, 5 * MS, 1000 * MS})
+    {
+        scheduler.setSpin(spin);
+        CHECK_EQ(scheduler.spinFor(2 * MS), 1 * MS);
+        CHECK_EQ(scheduler.spinFor(4 * MS), spin < 2 * MS ? spin : 2 * MS);
+        const uint64_t halfDefault = fallback->updateInterval() / 2;
+        CHECK_EQ(scheduler.spinFor(fallback->updateInterval()), spin < halfDefault ? spin : halfDefault);
+        // What the app's config loading does with tick_spin_us.
+        CHECK_EQ(TickScheduler::spinFor(spin, Mode::shortestTickInterval()), 1 * MS);
+    }
+    CHECK_EQ(TickScheduler::spinFor(700 * US, Mode::shortestTickInterval()), 700 * US);
+
+    // Through the engine: while a motion key is held in the mouse mode, each tick asks
+    // for the mouse mode's interval; once everything has stopped, for none.
+    key(VK_SPACE, true);
+    key('D', true);
+    for (int i = 0; i < 50; i++)
+    {
+        CHECK_EQ(KeyEngine::tick(), 4 * MS);
+        VirtualClock::advance(4 * MS);
+    }
+    key('D', false);
+    uint64_t interval = 0;
+    for (int i = 0; i < 1000 && (interval = KeyEngine::tick()) != KeyEngine::NO_TICK; i++)
+    {
+        CHECK_EQ(interval, 4 * MS);
+        VirtualClock::advance(4 * MS);
+    }
+    CHECK_EQ(interval, KeyEngine::NO_TICK);
+    CHECK(recorder.size() > 0);
+    key(VK_SPACE, false);
+    return test::result();
+}
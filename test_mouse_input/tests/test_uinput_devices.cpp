@@ -0,0 +1,75 @@
+// UinputBackend splits output between its relative and absolute devices: absolute moves
+// go only to the absolute pointer, everything else only to the relative device, in order.
+#include <fcntl.h>
+#include <linux/input.h>
+#include <unistd.h>
+#include <vector>
+#include "TestSupport.h"
+#include "UinputBackend.h"
+
+namespace
+{
+    std::vector<input_event> drain(int fd)
+    {
+        std::vector<input_event> events;
+        input_event event;
+        while (::read(fd, &event, sizeof(event)) == static_cast<ssize_t>(sizeof(event)))
+        {
+            events.push_back(event);
+        }
+        return events;
+    }
+}
+
+int main()
+{
+    int relative[2], absolute[2];
+    CHECK(pipe2(relative, O_NONBLOCK) == 0);
+    CHECK(pipe2(absolute, O_NONBLOCK) == 0);
+
+    UinputBackend backend;
+    backend.attach(relative[1], absolute[1], 1920, 1080);
+    const OutputEvent batch[] = {
+        OutputEvent::move(5, 0),
+        OutputEvent::moveTo(100, 200),
+        OutputEvent::mouseButton(MOUSE_LEFT, true),
+        OutputEvent::key('B', true),
+        OutputEvent::wheel(0, 120),
+    };
+    backend.submit(batch, sizeof(batch) / sizeof(batch[0]));
+    // Relative move, then (after the absolute run) button + key + wheel.
+    CHECK_EQ(backend.writeCount(), 3u);
+
+    const std::vector<input_event> rel = drain(relative[0]);
+    const std::vector<input_event> abs = drain(absolute[0]);
+    CHECK_EQ(abs.size(), 3u);
+    if (abs.size() == 3)
+    {
+        CHECK(abs[0].type == EV_ABS && abs[0].code == ABS_X && abs[0].value == 100);
+        CHECK(abs[1].type == EV_ABS && abs[1].code == ABS_Y && abs[1].value == 200);
+        CHECK(abs[2].type == EV_SYN);
+    }
+    // REL_X, SYN; BTN_LEFT, SYN; KEY_B, SYN; hi-res wheel, notch, SYN.
+    CHECK_EQ(rel.size(), 9u);
+    for (const input_event &event : rel)
+    {
+        CHECK(event.type != EV_ABS);
+    }
+    if (rel.size() == 9)
+    {
+        CHECK(rel[0].type == EV_REL && rel[0].code == REL_X && rel[0].value == 5);
+        CHECK(rel[2].type == EV_KEY && rel[2].code == BTN_LEFT);
+        CHECK(rel[4].type == EV_KEY && rel[4].code == KEY_B);
+        CHECK(rel[6].type == EV_REL && rel[6].code == REL_WHEEL_HI_RES && rel[6].value == 120);
+        CHECK(rel[7].type == EV_REL && rel[7].code == REL_WHEEL && rel[7].value == 1);
+    }
+
+    int x = 0, y = 0;
+    CHECK(backend.cursorPosition(x, y));
+    CHECK_EQ(x, 100);
+    CHECK_EQ(y, 200);
+    backend.close();
+    ::close(relative[0]);
+    ::close(absolute[0]);
+    return test::result();
+}